@@ -0,0 +1,41 @@
+/*
+ * Cycle Timing and Test Input for the Example Benchmarks
+ *
+ * Each example times its kernels with read_mcycle() and fills its buffers
+ * from rng_next(), so runs are repeatable and comparable across builds:
+ *
+ *   unsigned long start = read_mcycle();
+ *   kernel(buf, n);
+ *   example_bench[K_KERNEL] = (uint32_t)(read_mcycle() - start);
+ *
+ * Where the results go (cycles, cycles per byte, throughput) is up to the
+ * example, see its bench_run().
+ *
+ * Usage:
+ *   #include "bench.h"   (from a source in examples/)
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+/* Read the cycle counter (XLEN bits, so RV32 wraps after 2^32 cycles) */
+static inline unsigned long read_mcycle(void) {
+    unsigned long cycle;
+    __asm__ volatile ("csrr %0, mcycle" : "=r"(cycle));
+    return cycle;
+}
+
+/* Xorshift32 PRNG: the same sequence on every run and every architecture */
+static uint32_t rng_state = 0x12345678;
+
+static inline uint32_t rng_next(void) {
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_state = x;
+}
+
+#endif /* BENCH_H */
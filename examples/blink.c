@@ -83,25 +83,46 @@ static void gpio_init_output(uint32_t pin_mask) {
     GPIO_OUTPUT_EN |= pin_mask;   // Enable output
 }
 
+/*
+ * Output updates use AMOs when the A extension is available, so an ISR
+ * touching another pin of the same port cannot lose its update.
+ * See gpio_atomic.c for the full driver and the non-A fallback.
+ */
+
 /**
  * Set GPIO pin high
+ * Compiles to: amoor.w (with A extension)
  */
 static inline void gpio_set(uint32_t pin_mask) {
+#if defined(__riscv_atomic)
+    __atomic_fetch_or(&GPIO_OUTPUT_VAL, pin_mask, __ATOMIC_RELAXED);
+#else
     GPIO_OUTPUT_VAL |= pin_mask;
+#endif
 }
 
 /**
  * Set GPIO pin low
+ * Compiles to: amoand.w (with A extension)
  */
 static inline void gpio_clear(uint32_t pin_mask) {
+#if defined(__riscv_atomic)
+    __atomic_fetch_and(&GPIO_OUTPUT_VAL, ~pin_mask, __ATOMIC_RELAXED);
+#else
     GPIO_OUTPUT_VAL &= ~pin_mask;
+#endif
 }
 
 /**
  * Toggle GPIO pin
+ * Compiles to: amoxor.w (with A extension)
  */
 static inline void gpio_toggle(uint32_t pin_mask) {
+#if defined(__riscv_atomic)
+    __atomic_fetch_xor(&GPIO_OUTPUT_VAL, pin_mask, __ATOMIC_RELAXED);
+#else
     GPIO_OUTPUT_VAL ^= pin_mask;
+#endif
 }
 
 /* ============================================================================
@@ -0,0 +1,379 @@
+/*
+ * blink_timer.c - Interrupt-driven LED Pattern Engine and Software PWM
+ *
+ * Demonstrates:
+ *   - Blink patterns encoded as (pin-mask, duration) tables
+ *   - Pattern steps advanced from the MTIME timer interrupt
+ *   - Software PWM on several pins with configurable resolution
+ *   - Sleeping in wfi between edges instead of busy-waiting in delay()
+ *
+ * Build:
+ *   rv build examples/blink_timer.c --arch 32imac --bare
+ *
+ * Verify instructions:
+ *   rv dump build/blink_timer.elf --grep wfi
+ *   rv dump build/blink_timer.elf --grep mret
+ *
+ * Compared to blink.c, the CPU only runs for a few dozen instructions at
+ * each LED edge. The interrupt is programmed for the *next* edge of any
+ * pattern or PWM pin, so there is no periodic tick and no polling.
+ *
+ * Target: SiFive FE310 style CLINT and GPIO (the QEMU virt CLINT is at the
+ * same address; set MTIME_HZ to 10000000 there).
+ */
+
+#include <stdint.h>
+
+/* ============================================================================
+ * CONFIGURATION - Adjust these for your specific board/MCU
+ * ============================================================================ */
+
+// GPIO (same layout as blink.c)
+#define GPIO_BASE       0x10012000
+#define GPIO_INPUT_EN   (*(volatile uint32_t *)(GPIO_BASE + 0x04))
+#define GPIO_OUTPUT_EN  (*(volatile uint32_t *)(GPIO_BASE + 0x08))
+#define GPIO_OUTPUT_VAL (*(volatile uint32_t *)(GPIO_BASE + 0x0C))
+#define GPIO_IOF_EN     (*(volatile uint32_t *)(GPIO_BASE + 0x38))
+
+// CLINT (Core-Local Interruptor) - machine timer
+#define CLINT_BASE      0x02000000
+#define MTIMECMP_LO     (*(volatile uint32_t *)(CLINT_BASE + 0x4000))
+#define MTIMECMP_HI     (*(volatile uint32_t *)(CLINT_BASE + 0x4004))
+#define MTIME_LO        (*(volatile uint32_t *)(CLINT_BASE + 0xBFF8))
+#define MTIME_HI        (*(volatile uint32_t *)(CLINT_BASE + 0xBFFC))
+
+// MTIME frequency (FE310: 32.768 kHz RTC, QEMU virt: 10 MHz)
+#define MTIME_HZ        32768
+
+// LEDs
+#define LED_RED         (1U << 22)
+#define LED_GREEN       (1U << 19)
+#define LED_BLUE        (1U << 21)
+#define LED_ALL         (LED_RED | LED_GREEN | LED_BLUE)
+
+// Software PWM: period and number of duty steps per period
+#define PWM_PERIOD_US   10000       // 100 Hz, flicker-free for LEDs
+#define PWM_RESOLUTION  64          // Duty 0..64
+#define PWM_MAX_PINS    4
+
+// CSR bits
+#define MSTATUS_MIE     (1U << 3)
+#define MIE_MTIE        (1U << 7)
+
+// Time conversion (constant-folded, no division at run time)
+#define MS_TO_TICKS(ms) ((uint32_t)(((uint64_t)(ms) * MTIME_HZ) / 1000))
+#define US_TO_TICKS(us) ((uint32_t)(((uint64_t)(us) * MTIME_HZ) / 1000000))
+#define PWM_PERIOD_TICKS US_TO_TICKS(PWM_PERIOD_US)
+
+/* ============================================================================
+ * GPIO Helpers (atomic, see gpio_atomic.c)
+ * ============================================================================ */
+
+static void gpio_init_output(uint32_t pin_mask) {
+    GPIO_IOF_EN &= ~pin_mask;
+    GPIO_INPUT_EN &= ~pin_mask;
+    GPIO_OUTPUT_EN |= pin_mask;
+}
+
+/**
+ * Set/clear pins in one access
+ * Compiles to: amoor.w / amoand.w (with A extension)
+ */
+static inline void gpio_set(uint32_t pin_mask) {
+#if defined(__riscv_atomic)
+    __atomic_fetch_or(&GPIO_OUTPUT_VAL, pin_mask, __ATOMIC_RELAXED);
+#else
+    GPIO_OUTPUT_VAL |= pin_mask;
+#endif
+}
+
+static inline void gpio_clear(uint32_t pin_mask) {
+#if defined(__riscv_atomic)
+    __atomic_fetch_and(&GPIO_OUTPUT_VAL, ~pin_mask, __ATOMIC_RELAXED);
+#else
+    GPIO_OUTPUT_VAL &= ~pin_mask;
+#endif
+}
+
+/* ============================================================================
+ * Machine Timer
+ * ============================================================================ */
+
+/**
+ * Read the 64-bit MTIME counter on RV32
+ * Re-reads the high word to catch a carry between the two loads.
+ */
+static uint64_t mtime_read(void) {
+    uint32_t hi, lo;
+    do {
+        hi = MTIME_HI;
+        lo = MTIME_LO;
+    } while (hi != MTIME_HI);
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * Program the next timer interrupt
+ * Writing the high word to all-ones first avoids a spurious interrupt
+ * while the two halves are inconsistent.
+ */
+static void mtimecmp_write(uint64_t when) {
+    MTIMECMP_HI = 0xFFFFFFFF;
+    MTIMECMP_LO = (uint32_t)when;
+    MTIMECMP_HI = (uint32_t)(when >> 32);
+}
+
+/* ============================================================================
+ * Pattern Engine
+ * ============================================================================
+ *
+ * A pattern is a table of steps. Each step drives the channel's pins to
+ * 'pins' (1 = on) for 'ticks' MTIME ticks. Patterns loop forever.
+ */
+
+typedef struct {
+    uint32_t pins;      // Pins high during this step (subset of channel mask)
+    uint32_t ticks;     // Step duration in MTIME ticks
+} pattern_step_t;
+
+#define STEP(pins, ms)  { (pins), MS_TO_TICKS(ms) }
+
+typedef struct {
+    const pattern_step_t *steps;
+    uint32_t count;
+    uint32_t mask;      // Pins owned by this channel
+    uint32_t index;     // Current step
+    uint64_t deadline;  // MTIME of the next step
+} pattern_channel_t;
+
+/*
+ * The three patterns from blink.c, expressed as data
+ */
+#define ON  LED_RED
+#define OFF 0
+
+static const pattern_step_t pattern_simple[] = {
+    STEP(ON, 500), STEP(OFF, 500),
+};
+
+static const pattern_step_t pattern_heartbeat[] = {
+    STEP(ON, 100), STEP(OFF, 100),
+    STEP(ON, 100), STEP(OFF, 1000),
+};
+
+#undef ON
+#define ON  LED_GREEN
+
+// SOS: dot = 150 ms, dash = 600 ms, letter gap = 300 ms, word gap = 1200 ms
+static const pattern_step_t pattern_sos[] = {
+    STEP(ON, 150), STEP(OFF, 150), STEP(ON, 150), STEP(OFF, 150),
+    STEP(ON, 150), STEP(OFF, 300),
+    STEP(ON, 600), STEP(OFF, 150), STEP(ON, 600), STEP(OFF, 150),
+    STEP(ON, 600), STEP(OFF, 300),
+    STEP(ON, 150), STEP(OFF, 150), STEP(ON, 150), STEP(OFF, 150),
+    STEP(ON, 150), STEP(OFF, 1200),
+};
+
+#undef ON
+#undef OFF
+
+#define PATTERN_LEN(p)  (sizeof(p) / sizeof((p)[0]))
+#define MAX_CHANNELS    2
+
+static pattern_channel_t channels[MAX_CHANNELS];
+static uint32_t channel_count;
+
+/**
+ * Apply a step: drive the channel's pins, then schedule the next one
+ */
+static void pattern_apply(pattern_channel_t *ch) {
+    const pattern_step_t *step = &ch->steps[ch->index];
+    uint32_t on = step->pins & ch->mask;
+    uint32_t off = ch->mask & ~step->pins;
+
+    if (off) gpio_clear(off);
+    if (on)  gpio_set(on);
+    ch->deadline += step->ticks;
+}
+
+/**
+ * Start a looping pattern on the given pins
+ */
+static void pattern_start(const pattern_step_t *steps, uint32_t count, uint32_t mask, uint64_t now) {
+    pattern_channel_t *ch = &channels[channel_count++];
+    ch->steps = steps;
+    ch->count = count;
+    ch->mask = mask;
+    ch->index = 0;
+    ch->deadline = now;
+    pattern_apply(ch);
+}
+
+/* ============================================================================
+ * Software PWM
+ * ============================================================================
+ *
+ * All PWM pins turn on together at the start of a period and each turns off
+ * at its own offset. The timer is only programmed for those edges, so a
+ * period costs (number of distinct duties + 1) interrupts.
+ */
+
+typedef struct {
+    uint32_t mask;
+    uint32_t off_ticks;     // Offset of the falling edge within the period
+} pwm_pin_t;
+
+static pwm_pin_t pwm_pins[PWM_MAX_PINS];
+static uint32_t pwm_count;
+static uint64_t pwm_period_start;
+
+/**
+ * Set duty (0..PWM_RESOLUTION) of a PWM pin
+ * Takes effect from the next edge; safe to call with interrupts enabled
+ * because the ISR only reads a single aligned word.
+ */
+static void pwm_set_duty(uint32_t slot, uint32_t duty) {
+    if (duty > PWM_RESOLUTION) {
+        duty = PWM_RESOLUTION;
+    }
+    pwm_pins[slot].off_ticks = (PWM_PERIOD_TICKS * duty) / PWM_RESOLUTION;
+}
+
+/**
+ * Register a pin for PWM and return its slot
+ */
+static uint32_t pwm_add(uint32_t mask, uint32_t duty) {
+    uint32_t slot = pwm_count++;
+    pwm_pins[slot].mask = mask;
+    pwm_set_duty(slot, duty);
+    return slot;
+}
+
+/**
+ * Process PWM edges due at 'now' and return the time of the next edge
+ */
+static uint64_t pwm_update(uint64_t now) {
+    if (now - pwm_period_start >= PWM_PERIOD_TICKS) {
+        // Start a new period (resynchronize if we fell behind)
+        pwm_period_start += PWM_PERIOD_TICKS;
+        if (now - pwm_period_start >= PWM_PERIOD_TICKS) {
+            pwm_period_start = now;
+        }
+
+        uint32_t on = 0;
+        for (uint32_t i = 0; i < pwm_count; i++) {
+            if (pwm_pins[i].off_ticks) on |= pwm_pins[i].mask;
+        }
+        gpio_set(on);
+    }
+
+    uint32_t elapsed = (uint32_t)(now - pwm_period_start);
+    uint32_t next = PWM_PERIOD_TICKS;
+    uint32_t off = 0;
+
+    for (uint32_t i = 0; i < pwm_count; i++) {
+        uint32_t edge = pwm_pins[i].off_ticks;
+        if (edge >= PWM_PERIOD_TICKS) {
+            continue;                           // 100% duty: never off
+        }
+        if (edge <= elapsed) {
+            off |= pwm_pins[i].mask;            // Falling edge reached
+        } else if (edge < next) {
+            next = edge;                        // Earliest pending edge
+        }
+    }
+    gpio_clear(off);
+
+    return pwm_period_start + next;
+}
+
+/* ============================================================================
+ * Timer Interrupt
+ * ============================================================================ */
+
+/**
+ * Machine timer interrupt handler (installed directly in mtvec)
+ * Advances every pattern whose deadline passed, runs PWM edges and programs
+ * MTIMECMP for the earliest upcoming edge.
+ */
+__attribute__((interrupt("machine"), aligned(4)))
+void timer_isr(void) {
+    uint64_t now = mtime_read();
+    uint64_t next = UINT64_MAX;
+
+    if (pwm_count) {
+        next = pwm_update(now);
+    }
+
+    for (uint32_t i = 0; i < channel_count; i++) {
+        pattern_channel_t *ch = &channels[i];
+        while (ch->deadline <= now) {
+            ch->index = (ch->index + 1 == ch->count) ? 0 : ch->index + 1;
+            pattern_apply(ch);
+        }
+        if (ch->deadline < next) {
+            next = ch->deadline;
+        }
+    }
+
+    mtimecmp_write(next);
+}
+
+/**
+ * Install the handler and enable the machine timer interrupt
+ */
+static void engine_start(void) {
+    mtimecmp_write(mtime_read());       // Fire immediately to schedule edges
+    __asm__ volatile ("csrw mtvec, %0" : : "r"(timer_isr));
+    __asm__ volatile ("csrs mie, %0" : : "r"(MIE_MTIE));
+    __asm__ volatile ("csrs mstatus, %0" : : "r"(MSTATUS_MIE));
+}
+
+/* ============================================================================
+ * MAIN
+ * ============================================================================ */
+
+int main(void) {
+    gpio_init_output(LED_ALL);
+
+    // Select the red pattern (change to try different patterns)
+    #define PATTERN_SIMPLE      0
+    #define PATTERN_HEARTBEAT   1
+
+    int pattern = PATTERN_HEARTBEAT;
+    uint64_t now = mtime_read();
+
+    if (pattern == PATTERN_HEARTBEAT) {
+        pattern_start(pattern_heartbeat, PATTERN_LEN(pattern_heartbeat), LED_RED, now);
+    } else {
+        pattern_start(pattern_simple, PATTERN_LEN(pattern_simple), LED_RED, now);
+    }
+    pattern_start(pattern_sos, PATTERN_LEN(pattern_sos), LED_GREEN, now);
+
+    // Blue LED "breathes" through software PWM
+    uint32_t blue = pwm_add(LED_BLUE, 0);
+    pwm_period_start = now;
+
+    engine_start();
+
+    // Main loop: sleep until the next interrupt, ramp the PWM duty every 20 ms
+    uint64_t fade_deadline = now;
+    uint32_t duty = 0;
+    int32_t dir = 1;
+
+    while (1) {
+        __asm__ volatile ("wfi");
+
+        now = mtime_read();
+        if (now >= fade_deadline) {
+            fade_deadline += MS_TO_TICKS(20);
+            duty += dir;
+            if (duty == 0 || duty == PWM_RESOLUTION) {
+                dir = -dir;
+            }
+            pwm_set_duty(blue, duty);
+        }
+    }
+
+    return 0;  // Never reached
+}
@@ -16,6 +16,10 @@
  * 
  * The compressed version should be 25-30% smaller!
  * 
+ * Prologues and epilogues (many_locals, level1..level4) stay long with C
+ * alone. Compare against Zcb/Zcmp (cm.push/cm.pop) and -msave-restore:
+ *   rv density examples/compressed_test.c --run -F many_locals -F level1
+ * 
  * Note: The C extension doesn't add new functionality - it provides
  * 16-bit encodings for common 32-bit instructions, reducing code size.
  * The compiler automatically uses compressed instructions when beneficial.
@@ -0,0 +1,547 @@
+/*
+ * delta_patch.c - Streaming Delta Update Applier
+ *
+ * Demonstrates:
+ *   - Applying an 'rv delta' patch chunk by chunk as it arrives (UART, radio)
+ *   - Bounded RAM: one flash page buffer and the address map, whatever the
+ *     image size
+ *   - Predicting moved calls (jal) from the old image, so the patch carries
+ *     only real changes instead of every call whose offset shifted
+ *   - CRC32 checks of the old image before and the new image after patching
+ *
+ * Build:
+ *   rv build examples/delta_patch.c --arch 32imac --bare
+ *
+ * Create a patch:
+ *   rv delta old.elf new.elf -o update.rvd
+ *
+ * The old image is read in place from its flash slot and the new one is
+ * written page by page to another slot, so an update never needs RAM for
+ * either image. Patch layout (all little-endian / LEB128 varints):
+ *
+ *   header   40 bytes: magic "RVDP", version, header size, old size,
+ *            old CRC32, new size, new CRC32, old/new load address,
+ *            old code range
+ *   map      count, then (start offset increment, zigzag delta) pairs:
+ *            how code moved between the images
+ *   records  (diff_len << 2 | phase, extra_len, zigzag seek), the diff as
+ *            (zero run, count, bytes) pairs, then extra_len literal bytes
+ *
+ * New bytes are the predicted old bytes plus the diff. Predicted means a
+ * jal in the old code is re-encoded for where its call site and target
+ * moved according to the map.
+ */
+
+#include <stdint.h>
+
+/* ============================================================================
+ * CONFIGURATION - Adjust these for your specific board/MCU
+ * ============================================================================ */
+
+#define DELTA_PAGE_SIZE     256     // Flash program granularity
+#define DELTA_MAX_MAP       64      // Must match DELTA_MAX_MAP in rv
+
+#define DELTA_MAGIC         0x50445652  // "RVDP"
+#define DELTA_VERSION       1
+#define DELTA_HEADER_SIZE   40
+
+// delta_feed() results
+#define DELTA_OK            0       // Need more data
+#define DELTA_DONE          1       // New image written and verified
+#define DELTA_ERR_FORMAT    -1      // Bad magic/version or corrupt stream
+#define DELTA_ERR_OLD       -2      // Patch was made for a different image
+#define DELTA_ERR_CRC       -3      // Result does not match the new CRC
+#define DELTA_ERR_FLASH     -4      // Flash write failed
+
+/* ============================================================================
+ * CRC32 (nibble table, 64 bytes)
+ * ============================================================================ */
+
+static const uint32_t crc32_nibble[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+static uint32_t crc32_byte(uint32_t crc, uint8_t b) {
+    crc ^= b;
+    crc = (crc >> 4) ^ crc32_nibble[crc & 15];
+    return (crc >> 4) ^ crc32_nibble[crc & 15];
+}
+
+/* ============================================================================
+ * Applier State
+ * ============================================================================ */
+
+typedef int (*flash_write_fn)(uint32_t offset, const uint8_t *data, uint32_t len);
+
+enum {
+    ST_HEADER,
+    ST_MAP_COUNT,
+    ST_MAP_START,
+    ST_MAP_DELTA,
+    ST_REC_HEAD,
+    ST_REC_EXTRA,
+    ST_REC_SEEK,
+    ST_DIFF_ZEROS,
+    ST_DIFF_COUNT,
+    ST_DIFF_BYTES,
+    ST_EXTRA,
+    ST_DONE,
+};
+
+typedef struct {
+    // Old image (read in place)
+    const uint8_t *old;
+    uint32_t old_size;
+    uint32_t old_base;
+    uint32_t code_start;
+    uint32_t code_end;
+
+    // Address map: old offsets from start[i] moved by delta[i]
+    uint32_t map_start[DELTA_MAX_MAP];
+    int32_t map_delta[DELTA_MAX_MAP];
+    uint32_t map_count;
+
+    // Predicted-old reader: one buffered instruction
+    uint32_t rd_pos;            // Next old offset
+    uint32_t rd_insn;           // Offset of the buffered instruction
+    uint8_t rd_buf[4];
+    uint8_t rd_len;
+
+    // Patch parser
+    uint8_t state;
+    uint8_t hdr[DELTA_HEADER_SIZE];
+    uint32_t hdr_fill;
+    uint32_t var_value;
+    uint32_t var_shift;
+    uint32_t index;             // Map entry being read
+    uint32_t old_pos;
+    uint32_t diff_len;
+    uint32_t diff_left;
+    uint32_t extra_left;
+    uint32_t run_left;
+
+    // Output: page buffer flushed through 'write'
+    flash_write_fn write;
+    uint8_t page[DELTA_PAGE_SIZE];
+    uint32_t page_fill;
+    uint32_t out_size;
+    uint32_t new_size;
+    uint32_t new_crc;
+    uint32_t crc;
+    int error;
+} delta_t;
+
+static uint32_t get_le32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+/* ============================================================================
+ * Call Prediction
+ * ============================================================================ */
+
+/**
+ * New address of old address 'addr' according to the patch's map
+ */
+static uint32_t map_address(const delta_t *d, uint32_t addr) {
+    int32_t off = (int32_t)(addr - d->old_base);
+    uint32_t lo = 0, hi = d->map_count;
+
+    if (!d->map_count) {
+        return addr;
+    }
+    // Last entry with start <= off (entry 0 also covers anything before it)
+    while (hi - lo > 1) {
+        uint32_t mid = (lo + hi) / 2;
+        if ((int32_t)d->map_start[mid] <= off) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return addr + d->map_delta[lo];
+}
+
+static int32_t jal_offset(uint32_t w) {
+    uint32_t imm = ((w >> 31) & 1) << 20 | ((w >> 12) & 0xFF) << 12
+                 | ((w >> 20) & 1) << 11 | ((w >> 21) & 0x3FF) << 1;
+    return (int32_t)(imm << 11) >> 11;
+}
+
+static uint32_t jal_with_offset(uint32_t w, int32_t offset) {
+    uint32_t imm = (uint32_t)offset;
+    return (w & 0xFFF) | ((imm >> 20) & 1) << 31 | ((imm >> 1) & 0x3FF) << 21
+         | ((imm >> 11) & 1) << 20 | ((imm >> 12) & 0xFF) << 12;
+}
+
+/**
+ * Load the old instruction at 'at' into the reader, predicted for the new
+ * layout. Outside the code range every byte is its own "instruction".
+ */
+static void reader_load(delta_t *d, uint32_t at) {
+    uint8_t len = 1;
+
+    d->rd_insn = at;
+    if (at >= d->code_start && at + 2 <= d->code_end) {
+        len = (d->old[at] & 3) == 3 ? 4 : 2;
+    }
+    for (uint8_t i = 0; i < len; i++) {
+        d->rd_buf[i] = at + i < d->old_size ? d->old[at + i] : 0xFF;
+    }
+    d->rd_len = len;
+
+    if (len == 4 && at + 4 <= d->code_end && (d->rd_buf[0] & 0x7F) == 0x6F) {
+        uint32_t w = get_le32(d->rd_buf);
+        uint32_t pc = d->old_base + at;
+        int32_t offset = (int32_t)(map_address(d, pc + jal_offset(w)) - map_address(d, pc));
+        if (offset >= -(1 << 20) && offset < (1 << 20)) {
+            put_le32(d->rd_buf, jal_with_offset(w, offset));
+        }
+    }
+}
+
+/**
+ * Position the reader; 'phase' is how far 'pos' is into its instruction
+ */
+static void reader_seek(delta_t *d, uint32_t pos, uint32_t phase) {
+    d->rd_pos = pos;
+    d->rd_insn = pos - phase;
+    d->rd_len = 0;
+}
+
+static uint8_t reader_next(delta_t *d) {
+    while (d->rd_pos >= d->rd_insn + d->rd_len) {
+        reader_load(d, d->rd_insn + d->rd_len);
+    }
+    return d->rd_buf[d->rd_pos++ - d->rd_insn];
+}
+
+/* ============================================================================
+ * Output
+ * ============================================================================ */
+
+static void out_flush(delta_t *d) {
+    if (d->page_fill && !d->error) {
+        uint32_t offset = d->out_size - d->page_fill;
+        if (d->write(offset, d->page, d->page_fill) != 0) {
+            d->error = DELTA_ERR_FLASH;
+        }
+    }
+    d->page_fill = 0;
+}
+
+static void out_byte(delta_t *d, uint8_t b) {
+    if (d->out_size >= d->new_size) {
+        d->error = DELTA_ERR_FORMAT;
+        return;
+    }
+    d->crc = crc32_byte(d->crc, b);
+    d->page[d->page_fill++] = b;
+    d->out_size++;
+    if (d->page_fill == DELTA_PAGE_SIZE) {
+        out_flush(d);
+    }
+}
+
+/* ============================================================================
+ * Patch Parser
+ * ============================================================================ */
+
+/**
+ * Prepare to patch 'old' (old_size bytes, in place in flash)
+ * The new image is passed to 'write' in page-sized pieces, in order.
+ */
+void delta_init(delta_t *d, const uint8_t *old, uint32_t old_size, flash_write_fn write) {
+    d->old = old;
+    d->old_size = old_size;
+    d->write = write;
+    d->state = ST_HEADER;
+    d->hdr_fill = 0;
+    d->var_value = 0;
+    d->var_shift = 0;
+    d->map_count = 0;
+    d->old_pos = 0;
+    d->page_fill = 0;
+    d->out_size = 0;
+    d->crc = 0xFFFFFFFF;
+    d->error = 0;
+}
+
+/**
+ * Check the header and the old image it was made for
+ */
+static int parse_header(delta_t *d) {
+    const uint8_t *h = d->hdr;
+    uint32_t crc = 0xFFFFFFFF;
+
+    if (get_le32(h) != DELTA_MAGIC || (h[4] | h[5] << 8) != DELTA_VERSION ||
+        (h[6] | h[7] << 8) != DELTA_HEADER_SIZE) {
+        return DELTA_ERR_FORMAT;
+    }
+    if (get_le32(h + 8) != d->old_size) {
+        return DELTA_ERR_OLD;
+    }
+    for (uint32_t i = 0; i < d->old_size; i++) {
+        crc = crc32_byte(crc, d->old[i]);
+    }
+    if (~crc != get_le32(h + 12)) {
+        return DELTA_ERR_OLD;
+    }
+
+    d->new_size = get_le32(h + 16);
+    d->new_crc = get_le32(h + 20);
+    d->old_base = get_le32(h + 24);
+    d->code_start = get_le32(h + 32);
+    d->code_end = get_le32(h + 36);
+    return 0;
+}
+
+/**
+ * Accumulate one varint byte; returns 1 when d->var_value is complete
+ */
+static int varint_step(delta_t *d, uint8_t b) {
+    if (d->var_shift > 28) {
+        d->error = DELTA_ERR_FORMAT;
+        return 0;
+    }
+    d->var_value |= (uint32_t)(b & 0x7F) << d->var_shift;
+    d->var_shift += 7;
+    return !(b & 0x80);
+}
+
+static int32_t zigzag_decode(uint32_t v) {
+    return (int32_t)((v >> 1) ^ -(v & 1));
+}
+
+/**
+ * Finish the current record and move on
+ */
+static void record_done(delta_t *d) {
+    if (d->out_size == d->new_size) {
+        out_flush(d);
+        if (!d->error && ~d->crc != d->new_crc) {
+            d->error = DELTA_ERR_CRC;
+        }
+        d->state = ST_DONE;
+    } else {
+        d->state = ST_REC_HEAD;
+    }
+}
+
+/**
+ * Diff part of a record finished: literal bytes follow, if any
+ */
+static void diff_done(delta_t *d) {
+    if (d->extra_left) {
+        d->state = ST_EXTRA;
+    } else {
+        record_done(d);
+    }
+}
+
+/**
+ * Feed the next 'len' bytes of the patch
+ * Returns DELTA_OK (send more), DELTA_DONE, or a DELTA_ERR_* code.
+ */
+int delta_feed(delta_t *d, const uint8_t *data, uint32_t len) {
+    for (uint32_t i = 0; i < len && !d->error && d->state != ST_DONE; i++) {
+        uint8_t b = data[i];
+        uint32_t v;
+
+        switch (d->state) {
+        case ST_HEADER:
+            d->hdr[d->hdr_fill++] = b;
+            if (d->hdr_fill == DELTA_HEADER_SIZE) {
+                d->error = parse_header(d);
+                d->state = ST_MAP_COUNT;
+                // Empty new image: nothing to write, only its CRC to check
+                if (!d->error && d->new_size == 0) {
+                    record_done(d);
+                }
+            }
+            continue;
+
+        case ST_DIFF_BYTES:
+            out_byte(d, (uint8_t)(reader_next(d) + b));
+            d->diff_left--;
+            if (--d->run_left == 0) {
+                if (d->diff_left) {
+                    d->state = ST_DIFF_ZEROS;
+                } else {
+                    diff_done(d);
+                }
+            }
+            continue;
+
+        case ST_EXTRA:
+            out_byte(d, b);
+            if (--d->extra_left == 0) {
+                record_done(d);
+            }
+            continue;
+        }
+
+        // Remaining states read varints
+        if (!varint_step(d, b)) {
+            continue;
+        }
+        v = d->var_value;
+        d->var_value = 0;
+        d->var_shift = 0;
+
+        switch (d->state) {
+        case ST_MAP_COUNT:
+            if (v > DELTA_MAX_MAP) {
+                d->error = DELTA_ERR_FORMAT;
+            }
+            d->map_count = v;
+            d->index = 0;
+            d->state = v ? ST_MAP_START : ST_REC_HEAD;
+            break;
+
+        case ST_MAP_START:
+            d->map_start[d->index] = (d->index ? d->map_start[d->index - 1] : 0) + v;
+            d->state = ST_MAP_DELTA;
+            break;
+
+        case ST_MAP_DELTA:
+            d->map_delta[d->index++] = zigzag_decode(v);
+            d->state = d->index < d->map_count ? ST_MAP_START : ST_REC_HEAD;
+            break;
+
+        case ST_REC_HEAD:
+            d->diff_len = v >> 2;
+            reader_seek(d, d->old_pos, v & 3);
+            d->state = ST_REC_EXTRA;
+            break;
+
+        case ST_REC_EXTRA:
+            d->extra_left = v;
+            d->state = ST_REC_SEEK;
+            break;
+
+        case ST_REC_SEEK:
+            d->diff_left = d->diff_len;
+            d->old_pos += d->diff_len + zigzag_decode(v);
+            if (d->diff_left) {
+                d->state = ST_DIFF_ZEROS;
+            } else {
+                diff_done(d);
+            }
+            break;
+
+        case ST_DIFF_ZEROS:
+            if (v > d->diff_left) {
+                d->error = DELTA_ERR_FORMAT;
+                break;
+            }
+            // Unchanged bytes: copy the prediction as is
+            d->diff_left -= v;
+            while (v--) {
+                out_byte(d, reader_next(d));
+            }
+            d->state = ST_DIFF_COUNT;
+            break;
+
+        case ST_DIFF_COUNT:
+            if (v > d->diff_left) {
+                d->error = DELTA_ERR_FORMAT;
+            } else if (v) {
+                d->run_left = v;
+                d->state = ST_DIFF_BYTES;
+            } else if (d->diff_left) {
+                d->state = ST_DIFF_ZEROS;
+            } else {
+                diff_done(d);
+            }
+            break;
+        }
+    }
+
+    if (d->error) {
+        return d->error;
+    }
+    return d->state == ST_DONE ? DELTA_DONE : DELTA_OK;
+}
+
+/* ============================================================================
+ * Demo
+ * ============================================================================
+ *
+ * A 168-byte "firmware" with three functions calling each other, and a patch
+ * to a version with a new 16-byte function inserted after the first one and
+ * one changed instruction. The two calls whose targets moved are predicted
+ * from the map, so the 81-byte patch holds the header, the map, the new
+ * function, the changed instruction and the version string.
+ */
+
+static const uint8_t demo_old[168] = {
+    0x13, 0x0d, 0x9e, 0x26, 0x03, 0x90, 0x2f, 0x89, 0x33, 0x98, 0x31, 0x95,
+    0xa3, 0x50, 0x99, 0x09, 0xb3, 0x54, 0x0d, 0x6b, 0x13, 0x4a, 0xad, 0x6c,
+    0xef, 0x00, 0x80, 0x02, 0x13, 0x10, 0x8c, 0xf2, 0x33, 0xda, 0x8c, 0x65,
+    0x83, 0x96, 0xc4, 0xdb, 0x13, 0xb2, 0x4c, 0x6b, 0xef, 0x00, 0x00, 0x04,
+    0x33, 0x66, 0x27, 0x92, 0x93, 0x50, 0x18, 0x30, 0xa3, 0xb5, 0xb9, 0x34,
+    0x67, 0x80, 0x00, 0x00, 0x23, 0x77, 0xf8, 0xc6, 0x03, 0xe4, 0x03, 0x74,
+    0x13, 0xea, 0xa2, 0xc7, 0xa3, 0x6e, 0x0d, 0x93, 0xa3, 0x02, 0x09, 0xe0,
+    0x13, 0xbd, 0xec, 0xfa, 0xb3, 0x07, 0x0e, 0x83, 0xb3, 0xfc, 0xd3, 0xc1,
+    0xa3, 0xcb, 0xea, 0xee, 0xef, 0x00, 0x80, 0x00, 0x67, 0x80, 0x00, 0x00,
+    0x83, 0x31, 0x10, 0xab, 0x93, 0x1c, 0x01, 0xcc, 0x83, 0x20, 0x08, 0xd7,
+    0x13, 0xe1, 0x05, 0xaa, 0x23, 0x83, 0x15, 0x72, 0x23, 0x56, 0xd5, 0x58,
+    0x13, 0xb2, 0xff, 0x5a, 0x33, 0xaa, 0x62, 0x7e, 0xb3, 0xea, 0xaa, 0xc4,
+    0xa3, 0x61, 0x05, 0xbd, 0xef, 0xf0, 0xdf, 0xfa, 0x67, 0x80, 0x00, 0x00,
+    0x52, 0x56, 0x2d, 0x44, 0x45, 0x4d, 0x4f, 0x2d, 0x76, 0x31, 0x00, 0x00,
+};
+
+static const uint8_t demo_patch[81] = {
+    0x52, 0x56, 0x44, 0x50, 0x01, 0x00, 0x28, 0x00, 0xa8, 0x00, 0x00, 0x00,
+    0x8d, 0xcb, 0xb8, 0x75, 0xb8, 0x00, 0x00, 0x00, 0x7a, 0x97, 0xc8, 0x5c,
+    0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00,
+    0x9c, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x3c, 0x20, 0x80, 0x02, 0x0c,
+    0x07, 0x40, 0x00, 0x93, 0x82, 0x15, 0xdf, 0x23, 0xfb, 0x96, 0x2a, 0x33,
+    0x18, 0xa8, 0x8c, 0xb0, 0x03, 0x00, 0x03, 0x10, 0x04, 0x70, 0x97, 0x93,
+    0x6d, 0x47, 0x01, 0xff, 0x0d, 0x01, 0x01, 0x02, 0x00,
+};
+
+// "Flash slot" for the new image
+static uint8_t new_slot[512];
+
+volatile int delta_result;
+volatile uint32_t delta_new_size;
+
+static int demo_flash_write(uint32_t offset, const uint8_t *data, uint32_t len) {
+    if (offset + len > sizeof(new_slot)) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        new_slot[offset + i] = data[i];
+    }
+    return 0;
+}
+
+static delta_t delta;
+
+int main(void) {
+    int res = DELTA_OK;
+
+    delta_init(&delta, demo_old, sizeof(demo_old), demo_flash_write);
+
+    // Feed in odd-sized chunks, as they would arrive from a link
+    for (uint32_t off = 0; off < sizeof(demo_patch) && res == DELTA_OK; off += 7) {
+        uint32_t n = sizeof(demo_patch) - off < 7 ? sizeof(demo_patch) - off : 7;
+        res = delta_feed(&delta, demo_patch + off, n);
+    }
+
+    delta_result = res;
+    delta_new_size = delta.out_size;
+
+    return res == DELTA_DONE ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+/*
+ * fat_firmware.c - One Image, the Fastest Kernels on Every Board
+ *
+ * Demonstrates:
+ *   - Runtime ISA dispatch: fat_kernels.c is built for several -march
+ *     variants into one ELF ('rv build --multiversion')
+ *   - Boot-time resolver: crt0 reads misa and this board's Z-extension
+ *     mask (rv_board_zext) and points every kernel at its best variant
+ *   - Querying the pick: rv_dispatch_variant()
+ *   - Cycle benchmark of each kernel through its dispatch trampoline
+ *
+ * Build (base 32imac, plus Zba/Zbb and Zba/Zbb/Zicond variants):
+ *   rv build examples/fat_firmware.c --arch 32imac --bare -o build/fat.elf \
+ *       --multiversion examples/fat_kernels.c:32imac_zba_zbb_zicond,32imac_zba_zbb
+ *
+ * Run it (this board reports Zba/Zbb/Zicond: the first variant is picked):
+ *   rv run build/fat.elf -F popcount_words -F rotate_hash
+ *
+ * Other boards: misa has no Z-extension bits, so the mask comes from
+ * BOARD_ZEXT, which a real board reads from a strap or OTP word. Rebuild
+ * with a smaller mask (0x3 = Zba|Zbb) and run without the extensions the
+ * mask leaves out:
+ *   rv build ... --cflags -DBOARD_ZEXT=0x3 -o build/fat_zbb.elf
+ *   rv run build/fat_zbb.elf --march rv32imac_zba_zbb -F popcount_words
+ *   rv build ... --cflags -DBOARD_ZEXT=0 -o build/fat_base.elf
+ *   rv run build/fat_base.elf --march rv32imac -F popcount_words
+ *
+ * Verify the variants and trampolines:
+ *   rv syms build/fat.elf popcount_words
+ *   rv dump build/fat.elf -s popcount_words.32imac_zba_zbb --grep cpop
+ *
+ * Results are left in fat_bench[] (cycles per kernel), fat_variant[]
+ * (the architecture each kernel resolved to) and fat_errors.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bench.h"
+#include "rv_dispatch.h"
+
+/* ============================================================================
+ * CONFIGURATION
+ * ============================================================================ */
+
+// Z extensions of this board (misa covers the single letters)
+#ifndef BOARD_ZEXT
+#define BOARD_ZEXT      (RV_ZEXT_ZBA | RV_ZEXT_ZBB | RV_ZEXT_ZICOND)
+#endif
+
+// Benchmark size (words)
+#define BENCH_WORDS     1024
+
+/* ============================================================================
+ * Kernels (fat_kernels.c, one copy per variant)
+ * ============================================================================ */
+
+uint32_t popcount_words(const uint32_t *words, size_t n);
+uint32_t log2_sum(const uint32_t *words, size_t n);
+uint32_t rotate_hash(const uint32_t *words, size_t n);
+void clamp_samples(int32_t *samples, size_t n, int32_t lo, int32_t hi);
+void gate_samples(int32_t *samples, size_t n, int32_t threshold);
+
+/**
+ * Board support: the Z extensions this core implements
+ * Called by the resolver before main(); replaces the weak default (none).
+ */
+uint32_t rv_board_zext(void) {
+    return BOARD_ZEXT;
+}
+
+/* ============================================================================
+ * Benchmark
+ * ============================================================================ */
+
+enum { K_POPCOUNT, K_LOG2, K_HASH, K_CLAMP, K_GATE, KERNEL_COUNT };
+
+static const char *const kernel_names[KERNEL_COUNT] = {
+    "popcount_words", "log2_sum", "rotate_hash", "clamp_samples", "gate_samples",
+};
+
+/**
+ * Cycles per kernel: fat_bench[kernel], and the variant it ran
+ */
+volatile uint32_t fat_bench[KERNEL_COUNT];
+const char *volatile fat_variant[KERNEL_COUNT];
+volatile uint32_t fat_errors;
+
+static uint32_t bench_words[BENCH_WORDS];
+static int32_t bench_samples[BENCH_WORDS];
+
+// Plain references, the same on every board
+static uint32_t popcount_reference(const uint32_t *words, size_t n) {
+    uint32_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        for (uint32_t w = words[i]; w; w >>= 1) {
+            count += w & 1;
+        }
+    }
+    return count;
+}
+
+static uint32_t log2_reference(const uint32_t *words, size_t n) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        for (uint32_t w = words[i]; w > 1; w >>= 1) {
+            sum++;
+        }
+    }
+    return sum;
+}
+
+static uint32_t hash_reference(const uint32_t *words, size_t n) {
+    uint32_t h = 0x9E3779B9U;
+    for (size_t i = 0; i < n; i++) {
+        h ^= words[i];
+        h = (h << 13) | (h >> 19);
+        h *= 5;
+    }
+    return h;
+}
+
+static void bench_run(void) {
+    unsigned long start;
+    uint32_t result;
+
+    for (size_t i = 0; i < BENCH_WORDS; i++) {
+        // Varying magnitudes for log2, some zeros
+        bench_words[i] = rng_next() >> (i % 32);
+        bench_samples[i] = (int32_t)(rng_next() % 2000) - 1000;
+    }
+
+    start = read_mcycle();
+    result = popcount_words(bench_words, BENCH_WORDS);
+    fat_bench[K_POPCOUNT] = (uint32_t)(read_mcycle() - start);
+    if (result != popcount_reference(bench_words, BENCH_WORDS)) fat_errors++;
+
+    start = read_mcycle();
+    result = log2_sum(bench_words, BENCH_WORDS);
+    fat_bench[K_LOG2] = (uint32_t)(read_mcycle() - start);
+    if (result != log2_reference(bench_words, BENCH_WORDS)) fat_errors++;
+
+    start = read_mcycle();
+    result = rotate_hash(bench_words, BENCH_WORDS);
+    fat_bench[K_HASH] = (uint32_t)(read_mcycle() - start);
+    if (result != hash_reference(bench_words, BENCH_WORDS)) fat_errors++;
+
+    start = read_mcycle();
+    clamp_samples(bench_samples, BENCH_WORDS, -500, 500);
+    fat_bench[K_CLAMP] = (uint32_t)(read_mcycle() - start);
+
+    start = read_mcycle();
+    gate_samples(bench_samples, BENCH_WORDS, 0);
+    fat_bench[K_GATE] = (uint32_t)(read_mcycle() - start);
+    for (size_t i = 0; i < BENCH_WORDS; i++) {
+        if (bench_samples[i] < 0 || bench_samples[i] > 500) {
+            fat_errors++;
+            break;
+        }
+    }
+
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+        fat_variant[k] = rv_dispatch_variant(kernel_names[k]);
+        if (!fat_variant[k]) fat_errors++;
+    }
+}
+
+/* ============================================================================
+ * Main
+ * ============================================================================ */
+
+int main(void) {
+    bench_run();
+    return (int)fat_errors;
+}
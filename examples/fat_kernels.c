@@ -0,0 +1,78 @@
+/*
+ * fat_kernels.c - Kernels Compiled Once per ISA Variant (see fat_firmware.c)
+ *
+ * Built with 'rv build --multiversion', this file is compiled for every
+ * listed architecture plus the base --arch, and each function gets the
+ * fastest copy the core supports at boot. The source is plain C: the
+ * compiler picks cpop/clz/ror/min/czero when the variant has Zbb/Zicond
+ * and falls back to shifts, loops and branches otherwise.
+ *
+ * Rules for a multiversioned file:
+ *   - Only functions may be global (data lives in fat_firmware.c)
+ *   - Static helpers and static data are fine (each copy has its own)
+ *   - Every variant must use the same -mabi as --arch
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Set bits in a buffer of words (Zbb: cpop)
+ */
+uint32_t popcount_words(const uint32_t *words, size_t n) {
+    uint32_t count = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        count += (uint32_t)__builtin_popcount(words[i]);
+    }
+    return count;
+}
+
+/**
+ * Sum of floor(log2(x)) over the nonzero words (Zbb: clz)
+ */
+uint32_t log2_sum(const uint32_t *words, size_t n) {
+    uint32_t sum = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        if (words[i]) {
+            sum += 31 - (uint32_t)__builtin_clz(words[i]);
+        }
+    }
+    return sum;
+}
+
+/**
+ * Rotate-multiply hash of a word buffer (Zbb: ror, Zba: sh2add)
+ */
+uint32_t rotate_hash(const uint32_t *words, size_t n) {
+    uint32_t h = 0x9E3779B9U;
+
+    for (size_t i = 0; i < n; i++) {
+        h ^= words[i];
+        h = (h << 13) | (h >> 19);
+        h *= 5;
+    }
+    return h;
+}
+
+/**
+ * Clamp every sample to [lo, hi] in place (Zbb: min/max)
+ */
+void clamp_samples(int32_t *samples, size_t n, int32_t lo, int32_t hi) {
+    for (size_t i = 0; i < n; i++) {
+        int32_t s = samples[i];
+        s = s < lo ? lo : s;
+        samples[i] = s > hi ? hi : s;
+    }
+}
+
+/**
+ * Keep the samples above threshold, zero the rest (Zicond: czero.eqz)
+ */
+void gate_samples(int32_t *samples, size_t n, int32_t threshold) {
+    for (size_t i = 0; i < n; i++) {
+        int32_t s = samples[i];
+        samples[i] = s > threshold ? s : 0;
+    }
+}
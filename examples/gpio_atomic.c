@@ -0,0 +1,288 @@
+/*
+ * gpio_atomic.c - Interrupt-safe GPIO Driver using AMO Instructions
+ *
+ * Demonstrates:
+ *   - Atomic pin set/clear/toggle with amoor.w / amoand.w / amoxor.w
+ *   - Batched multi-pin updates in a single bus access
+ *   - Short interrupt-masked sections as a fallback without the A extension
+ *   - Cycle cost of a plain read-modify-write vs the atomic versions
+ *
+ * Build (AMO path):
+ *   rv build examples/gpio_atomic.c --arch 32imac --bare
+ *
+ * Build (interrupt-masked fallback, no A extension):
+ *   rv build examples/gpio_atomic.c --arch 32imc --bare
+ *
+ * Verify instructions:
+ *   rv dump build/gpio_atomic.elf --grep amoor
+ *   rv dump build/gpio_atomic.elf --grep csrrci
+ *
+ * Why: "GPIO_OUTPUT_VAL |= mask" is a load, an OR and a store. If an
+ * interrupt handler changes another pin of the same port between the load
+ * and the store, its update is silently lost. An AMO performs the whole
+ * operation as one bus transaction, so no window exists.
+ *
+ * Note: The peripheral region must support AMOs (SiFive GPIO does, see the
+ * FE310 manual "Physical Memory Attributes"). Check your MCU's PMA table.
+ */
+
+#include <stdint.h>
+
+/* ============================================================================
+ * CONFIGURATION - Adjust these for your specific board/MCU
+ * ============================================================================ */
+
+// GPIO Configuration (same layout as blink.c, SiFive-style GPIO)
+#define GPIO_BASE       0x10012000
+
+#define GPIO_REG(off)   ((volatile uint32_t *)(GPIO_BASE + (off)))
+#define GPIO_INPUT_EN   GPIO_REG(0x04)
+#define GPIO_OUTPUT_EN  GPIO_REG(0x08)
+#define GPIO_OUTPUT_VAL GPIO_REG(0x0C)
+#define GPIO_IOF_EN     GPIO_REG(0x38)
+
+// Pins used by the demo
+#define LED_RED         (1U << 22)
+#define LED_GREEN       (1U << 19)
+#define LED_BLUE        (1U << 21)
+#define LED_ALL         (LED_RED | LED_GREEN | LED_BLUE)
+
+// Number of toggles per benchmark run
+#define BENCH_TOGGLES   64
+
+// mstatus.MIE - global machine interrupt enable
+#define MSTATUS_MIE     (1U << 3)
+
+/* ============================================================================
+ * Interrupt Masking (fallback path)
+ * ============================================================================ */
+
+/**
+ * Disable machine interrupts and return the previous mstatus
+ * Compiles to: csrrci a0, mstatus, 8
+ */
+static inline uint32_t irq_save(void) {
+    uint32_t mstatus;
+    __asm__ volatile ("csrrci %0, mstatus, %1" : "=r"(mstatus) : "i"(MSTATUS_MIE) : "memory");
+    return mstatus;
+}
+
+/**
+ * Restore the interrupt enable bit saved by irq_save()
+ * Only MIE is written back, so other mstatus fields are untouched.
+ */
+static inline void irq_restore(uint32_t mstatus) {
+    __asm__ volatile ("csrs mstatus, %0" : : "r"(mstatus & MSTATUS_MIE) : "memory");
+}
+
+/* ============================================================================
+ * Atomic Register Primitives
+ * ============================================================================
+ *
+ * Each primitive returns the register value before the update, like the AMO
+ * instructions themselves. With the A extension this is one instruction;
+ * without it, the load/modify/store runs with interrupts masked, which is
+ * a 4-5 instruction critical section.
+ */
+
+#if defined(__riscv_atomic)
+
+/**
+ * Atomic OR on a device register
+ * Compiles to: amoor.w a0, a1, (a0)
+ */
+static inline uint32_t reg_or(volatile uint32_t *reg, uint32_t mask) {
+    uint32_t old;
+    __asm__ volatile ("amoor.w %0, %1, (%2)" : "=r"(old) : "r"(mask), "r"(reg) : "memory");
+    return old;
+}
+
+/**
+ * Atomic AND on a device register
+ * Compiles to: amoand.w a0, a1, (a0)
+ */
+static inline uint32_t reg_and(volatile uint32_t *reg, uint32_t mask) {
+    uint32_t old;
+    __asm__ volatile ("amoand.w %0, %1, (%2)" : "=r"(old) : "r"(mask), "r"(reg) : "memory");
+    return old;
+}
+
+/**
+ * Atomic XOR on a device register
+ * Compiles to: amoxor.w a0, a1, (a0)
+ */
+static inline uint32_t reg_xor(volatile uint32_t *reg, uint32_t mask) {
+    uint32_t old;
+    __asm__ volatile ("amoxor.w %0, %1, (%2)" : "=r"(old) : "r"(mask), "r"(reg) : "memory");
+    return old;
+}
+
+#else  /* !__riscv_atomic */
+
+/*
+ * Fallback: same semantics, protected by masking interrupts around the
+ * load/store pair. Not safe against other harts, only against local ISRs.
+ */
+
+static inline uint32_t reg_or(volatile uint32_t *reg, uint32_t mask) {
+    uint32_t flags = irq_save();
+    uint32_t old = *reg;
+    *reg = old | mask;
+    irq_restore(flags);
+    return old;
+}
+
+static inline uint32_t reg_and(volatile uint32_t *reg, uint32_t mask) {
+    uint32_t flags = irq_save();
+    uint32_t old = *reg;
+    *reg = old & mask;
+    irq_restore(flags);
+    return old;
+}
+
+static inline uint32_t reg_xor(volatile uint32_t *reg, uint32_t mask) {
+    uint32_t flags = irq_save();
+    uint32_t old = *reg;
+    *reg = old ^ mask;
+    irq_restore(flags);
+    return old;
+}
+
+#endif /* __riscv_atomic */
+
+/* ============================================================================
+ * GPIO Driver
+ * ============================================================================ */
+
+/**
+ * Initialize pins as outputs
+ * Called once at startup, but still uses the atomic primitives so that it
+ * is safe even if interrupts are already running.
+ */
+void gpio_init_output(uint32_t pin_mask) {
+    reg_and(GPIO_IOF_EN, ~pin_mask);     // Disable I/O functions (use as GPIO)
+    reg_and(GPIO_INPUT_EN, ~pin_mask);   // Disable input
+    reg_or(GPIO_OUTPUT_EN, pin_mask);    // Enable output
+}
+
+/**
+ * Drive all pins in pin_mask high (one bus access for any number of pins)
+ * Returns the previous output value.
+ */
+uint32_t gpio_set(uint32_t pin_mask) {
+    return reg_or(GPIO_OUTPUT_VAL, pin_mask);
+}
+
+/**
+ * Drive all pins in pin_mask low
+ */
+uint32_t gpio_clear(uint32_t pin_mask) {
+    return reg_and(GPIO_OUTPUT_VAL, ~pin_mask);
+}
+
+/**
+ * Invert all pins in pin_mask
+ */
+uint32_t gpio_toggle(uint32_t pin_mask) {
+    return reg_xor(GPIO_OUTPUT_VAL, pin_mask);
+}
+
+/**
+ * Batched write: pins in pin_mask take the matching bits of value
+ *
+ * If all selected pins go the same direction this is a single AMO.
+ * Otherwise it is two AMOs (clear, then set). Each pin still changes
+ * exactly once, so there are no glitches; only the skew between the
+ * falling and rising pins is one bus access.
+ */
+void gpio_write(uint32_t pin_mask, uint32_t value) {
+    uint32_t set = pin_mask & value;
+    uint32_t clr = pin_mask & ~value;
+
+    if (clr) {
+        reg_and(GPIO_OUTPUT_VAL, ~clr);
+    }
+    if (set) {
+        reg_or(GPIO_OUTPUT_VAL, set);
+    }
+}
+
+/**
+ * Batched write with all pins changing on the same store
+ * Use this when the pins form a parallel bus that must switch together.
+ * Costs a short interrupt-masked section on every core.
+ */
+void gpio_write_sync(uint32_t pin_mask, uint32_t value) {
+    uint32_t flags = irq_save();
+    uint32_t out = *GPIO_OUTPUT_VAL;
+    *GPIO_OUTPUT_VAL = (out & ~pin_mask) | (value & pin_mask);
+    irq_restore(flags);
+}
+
+/* ============================================================================
+ * Cycle Comparison
+ * ============================================================================ */
+
+/**
+ * Read MCYCLE - Machine Cycle Counter (lower 32 bits)
+ */
+static inline uint32_t read_mcycle(void) {
+    uint32_t cycle;
+    __asm__ volatile ("csrr %0, mcycle" : "=r"(cycle));
+    return cycle;
+}
+
+/**
+ * Results in cycles per toggle (inspect with a debugger):
+ *   [0] plain read-modify-write (not interrupt-safe)
+ *   [1] gpio_toggle (AMO, or masked fallback)
+ *   [2] gpio_write_sync (always masked)
+ */
+volatile uint32_t gpio_bench_cycles[3];
+
+static void gpio_bench(void) {
+    uint32_t start;
+
+    start = read_mcycle();
+    for (int i = 0; i < BENCH_TOGGLES; i++) {
+        *GPIO_OUTPUT_VAL ^= LED_RED;
+    }
+    gpio_bench_cycles[0] = (read_mcycle() - start) / BENCH_TOGGLES;
+
+    start = read_mcycle();
+    for (int i = 0; i < BENCH_TOGGLES; i++) {
+        gpio_toggle(LED_RED);
+    }
+    gpio_bench_cycles[1] = (read_mcycle() - start) / BENCH_TOGGLES;
+
+    start = read_mcycle();
+    for (int i = 0; i < BENCH_TOGGLES; i++) {
+        gpio_write_sync(LED_RED, (i & 1) ? LED_RED : 0);
+    }
+    gpio_bench_cycles[2] = (read_mcycle() - start) / BENCH_TOGGLES;
+}
+
+/* ============================================================================
+ * Main - Exercise all functions
+ * ============================================================================ */
+
+int main(void) {
+    gpio_init_output(LED_ALL);
+
+    // Single pins
+    gpio_set(LED_RED);
+    gpio_clear(LED_RED);
+    gpio_toggle(LED_GREEN);
+
+    // Batched: all three LEDs in one access
+    gpio_set(LED_ALL);
+    gpio_clear(LED_ALL);
+
+    // Mixed directions: red on, green and blue off
+    gpio_write(LED_ALL, LED_RED);
+    gpio_write_sync(LED_ALL, LED_GREEN | LED_BLUE);
+
+    gpio_bench();
+
+    return (int)gpio_bench_cycles[1];
+}
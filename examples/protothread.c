@@ -0,0 +1,426 @@
+/*
+ * protothread.c - Stackless Coroutines for Event-driven Firmware
+ *
+ * Demonstrates:
+ *   - Protothread-style resumable functions (switch-based local continuations)
+ *   - Per-task state in plain structs instead of per-task stacks
+ *   - Awaiting timers, semaphores and ring buffers without busy-waiting
+ *   - A run queue that only executes tasks that are ready
+ *
+ * Build:
+ *   rv build examples/protothread.c --arch 32imac --bare
+ *
+ * Verify size:
+ *   rv dump build/protothread.elf --grep "<sched_run>:"
+ *
+ * Memory: every task below costs sizeof(task_t) + its own state (about
+ * 24-32 bytes on RV32), and all tasks share the single stack from the
+ * linker script. A preemptive RTOS would need a separate stack (typically
+ * 256 bytes - 1 KB) per task, so 40 tasks fit here in ~1.2 KB instead of
+ * 10-40 KB.
+ *
+ * Rules for coroutine bodies (same as classic protothreads):
+ *   - Local variables do NOT survive an await. Keep them in the state struct.
+ *   - Do not use switch statements that span an await.
+ *   - Await macros may only be used directly in the task function.
+ */
+
+#include <stdint.h>
+
+/* ============================================================================
+ * CONFIGURATION - Adjust these for your specific board/MCU
+ * ============================================================================ */
+
+// CLINT machine timer (FE310 / QEMU virt)
+#define CLINT_BASE      0x02000000
+#define MTIMECMP_LO     (*(volatile uint32_t *)(CLINT_BASE + 0x4000))
+#define MTIMECMP_HI     (*(volatile uint32_t *)(CLINT_BASE + 0x4004))
+#define MTIME_LO        (*(volatile uint32_t *)(CLINT_BASE + 0xBFF8))
+#define MTIME_HI        (*(volatile uint32_t *)(CLINT_BASE + 0xBFFC))
+
+#define MIE_MTIE        (1U << 7)
+
+#define NUM_BLINKERS    32
+#define RING_SIZE       16          // Power of 2
+
+/* ============================================================================
+ * Coroutine Core
+ * ============================================================================
+ *
+ * A coroutine is a function that is re-entered from the top on every run.
+ * 'lc' (local continuation) holds the source line of the last await, and
+ * PT_BEGIN's switch jumps straight back to it.
+ */
+
+typedef struct task task_t;
+typedef int (*task_fn_t)(task_t *task);
+
+struct task {
+    uint32_t lc;            // Local continuation (0 = start)
+    task_fn_t fn;
+    task_t *next;           // Run queue / wait list link
+    uint32_t wake_at;       // Deadline while sleeping
+};
+
+// Task function return values
+#define PT_WAITING      0   // Parked on a wait list, do not requeue
+#define PT_YIELDED      1   // Still runnable, requeue at the back
+#define PT_DONE         2   // Finished, drop from the scheduler
+
+#define PT_BEGIN(t)     switch ((t)->lc) { case 0:
+#define PT_END(t)       } (t)->lc = 0; return PT_DONE
+
+// Suspend: save the resume point and return 'ret' to the scheduler
+#define PT_SUSPEND(t, ret) \
+    do { (t)->lc = __LINE__; return (ret); case __LINE__:; } while (0)
+
+/**
+ * Give other tasks a turn
+ */
+#define PT_YIELD(t)     PT_SUSPEND(t, PT_YIELDED)
+
+/**
+ * Polled wait: the task stays on the run queue and re-checks 'cond' each
+ * pass. Use for flags set from interrupt handlers.
+ */
+#define PT_WAIT_UNTIL(t, cond) \
+    do { while (!(cond)) PT_SUSPEND(t, PT_YIELDED); } while (0)
+
+/**
+ * Sleep for 'ticks' MTIME ticks (task is parked on the timer list)
+ */
+#define PT_SLEEP(t, ticks) \
+    do { sleep_insert((t), mtime_now() + (ticks)); PT_SUSPEND(t, PT_WAITING); } while (0)
+
+/**
+ * Sleep until an absolute deadline, for drift-free periodic tasks
+ */
+#define PT_SLEEP_UNTIL(t, deadline) \
+    do { sleep_insert((t), (deadline)); PT_SUSPEND(t, PT_WAITING); } while (0)
+
+/**
+ * Take one unit from a semaphore, parking the task while it is zero
+ * sem_signal() hands the unit directly to the first waiter.
+ */
+#define PT_SEM_WAIT(t, s) \
+    do { \
+        if ((s)->count > 0) { \
+            (s)->count--; \
+        } else { \
+            list_append(&(s)->waiters, (t)); \
+            PT_SUSPEND(t, PT_WAITING); \
+        } \
+    } while (0)
+
+/**
+ * Pop a byte from a ring buffer into 'out', parking while it is empty
+ */
+#define PT_RING_GET(t, r, out) \
+    do { \
+        while ((r)->head == (r)->tail) { \
+            (r)->reader = (t); \
+            PT_SUSPEND(t, PT_WAITING); \
+        } \
+        (out) = (r)->buf[(r)->tail++ & (RING_SIZE - 1)]; \
+        if ((r)->writer) sched_ready_steal(&(r)->writer); \
+    } while (0)
+
+/**
+ * Push a byte, parking while the ring is full
+ */
+#define PT_RING_PUT(t, r, val) \
+    do { \
+        while ((uint8_t)((r)->head - (r)->tail) == RING_SIZE) { \
+            (r)->writer = (t); \
+            PT_SUSPEND(t, PT_WAITING); \
+        } \
+        (r)->buf[(r)->head++ & (RING_SIZE - 1)] = (val); \
+        if ((r)->reader) sched_ready_steal(&(r)->reader); \
+    } while (0)
+
+/* ============================================================================
+ * Scheduler
+ * ============================================================================ */
+
+typedef struct {
+    task_t *head;
+    task_t *tail;
+} task_list_t;
+
+static task_list_t run_queue;
+static task_t *sleep_list;          // Sorted by wake_at
+
+static inline uint32_t mtime_now(void) {
+    return MTIME_LO;
+}
+
+// Wrap-safe "a is at or after b"
+static inline int time_reached(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) >= 0;
+}
+
+static void list_append(task_list_t *list, task_t *t) {
+    t->next = 0;
+    if (list->tail) {
+        list->tail->next = t;
+    } else {
+        list->head = t;
+    }
+    list->tail = t;
+}
+
+static task_t *list_pop(task_list_t *list) {
+    task_t *t = list->head;
+    if (t) {
+        list->head = t->next;
+        if (!list->head) {
+            list->tail = 0;
+        }
+    }
+    return t;
+}
+
+/**
+ * Make a task runnable
+ */
+static void sched_ready(task_t *t) {
+    list_append(&run_queue, t);
+}
+
+/**
+ * Wake the task stored in *slot (if any) and clear the slot
+ */
+static void sched_ready_steal(task_t **slot) {
+    task_t *t = *slot;
+    *slot = 0;
+    sched_ready(t);
+}
+
+/**
+ * Park a task on the timer list (kept sorted so expiry is O(1))
+ */
+static void sleep_insert(task_t *t, uint32_t wake_at) {
+    task_t **pp = &sleep_list;
+    t->wake_at = wake_at;
+    while (*pp && time_reached(wake_at, (*pp)->wake_at)) {
+        pp = &(*pp)->next;
+    }
+    t->next = *pp;
+    *pp = t;
+}
+
+/**
+ * Add a new task
+ */
+static void task_spawn(task_t *t, task_fn_t fn) {
+    t->lc = 0;
+    t->fn = fn;
+    sched_ready(t);
+}
+
+/**
+ * Idle until the next timer deadline
+ * MTIE is enabled in mie but interrupts stay globally off (mstatus.MIE=0),
+ * so wfi returns when the timer fires without taking a trap.
+ */
+static void sched_idle(uint32_t deadline) {
+    uint32_t hi, lo;
+    do {
+        hi = MTIME_HI;
+        lo = MTIME_LO;
+    } while (hi != MTIME_HI);
+
+    if (time_reached(lo, deadline)) {
+        return;             // Already due
+    }
+    if (deadline < lo) {
+        hi++;               // Deadline is past the next 2^32 wrap
+    }
+
+    MTIMECMP_HI = 0xFFFFFFFF;
+    MTIMECMP_LO = deadline;
+    MTIMECMP_HI = hi;
+    __asm__ volatile ("wfi");
+}
+
+/**
+ * Run tasks forever (or until every task finished)
+ */
+void sched_run(void) {
+    __asm__ volatile ("csrs mie, %0" : : "r"(MIE_MTIE));
+
+    while (run_queue.head || sleep_list) {
+        // Move expired sleepers to the run queue
+        uint32_t now = mtime_now();
+        while (sleep_list && time_reached(now, sleep_list->wake_at)) {
+            task_t *t = sleep_list;
+            sleep_list = t->next;
+            sched_ready(t);
+        }
+
+        task_t *t = list_pop(&run_queue);
+        if (!t) {
+            sched_idle(sleep_list->wake_at);
+            continue;
+        }
+
+        if (t->fn(t) == PT_YIELDED) {
+            sched_ready(t);
+        }
+    }
+}
+
+/* ============================================================================
+ * Synchronization Objects
+ * ============================================================================ */
+
+typedef struct {
+    int32_t count;
+    task_list_t waiters;
+} sem_t;
+
+static void sem_init(sem_t *s, int32_t count) {
+    s->count = count;
+    s->waiters.head = s->waiters.tail = 0;
+}
+
+/**
+ * Release one unit: wake a waiter if any, otherwise bank it
+ */
+static void sem_signal(sem_t *s) {
+    task_t *t = list_pop(&s->waiters);
+    if (t) {
+        sched_ready(t);
+    } else {
+        s->count++;
+    }
+}
+
+typedef struct {
+    uint8_t buf[RING_SIZE];
+    uint8_t head;
+    uint8_t tail;
+    task_t *reader;         // Task parked on empty
+    task_t *writer;         // Task parked on full
+} ring_t;
+
+/* ============================================================================
+ * Example Tasks
+ * ============================================================================ */
+
+/**
+ * Blinker: periodic task with its own period and counter
+ */
+typedef struct {
+    task_t task;            // Must be first (task_t * <-> blinker_t *)
+    uint32_t period;
+    uint32_t next;
+    uint32_t toggles;
+} blinker_t;
+
+static int blinker_fn(task_t *t) {
+    blinker_t *b = (blinker_t *)t;
+
+    PT_BEGIN(t);
+    b->next = mtime_now();
+    while (1) {
+        b->toggles++;
+        b->next += b->period;
+        PT_SLEEP_UNTIL(t, b->next);
+    }
+    PT_END(t);
+}
+
+/**
+ * Producer / consumer pair over a ring buffer
+ */
+static ring_t pipe;
+
+typedef struct {
+    task_t task;
+    uint8_t i;
+} producer_t;
+
+static int producer_fn(task_t *t) {
+    producer_t *p = (producer_t *)t;
+
+    PT_BEGIN(t);
+    for (p->i = 0; p->i < 100; p->i++) {
+        PT_RING_PUT(t, &pipe, p->i);
+    }
+    PT_END(t);
+}
+
+typedef struct {
+    task_t task;
+    uint8_t byte;
+    uint32_t sum;
+    uint32_t count;
+} consumer_t;
+
+static int consumer_fn(task_t *t) {
+    consumer_t *c = (consumer_t *)t;
+
+    PT_BEGIN(t);
+    while (c->count < 100) {
+        PT_RING_GET(t, &pipe, c->byte);
+        c->sum += c->byte;
+        c->count++;
+    }
+    PT_END(t);
+}
+
+/**
+ * Workers sharing a resource guarded by a semaphore
+ */
+static sem_t bus;
+static volatile uint32_t bus_owner_count;
+
+typedef struct {
+    task_t task;
+    uint32_t rounds;
+} worker_t;
+
+static int worker_fn(task_t *t) {
+    worker_t *w = (worker_t *)t;
+
+    PT_BEGIN(t);
+    while (w->rounds < 5) {
+        PT_SEM_WAIT(t, &bus);
+        bus_owner_count++;          // Exclusive section, may await inside
+        PT_SLEEP(t, 100);
+        bus_owner_count--;
+        sem_signal(&bus);
+        w->rounds++;
+        PT_YIELD(t);
+    }
+    PT_END(t);
+}
+
+/* ============================================================================
+ * Main
+ * ============================================================================ */
+
+static blinker_t blinkers[NUM_BLINKERS];
+static producer_t producer;
+static consumer_t consumer;
+static worker_t workers[4];
+
+int main(void) {
+    for (int i = 0; i < NUM_BLINKERS; i++) {
+        blinkers[i].period = 1000 + 250 * i;
+        task_spawn(&blinkers[i].task, blinker_fn);
+    }
+
+    task_spawn(&producer.task, producer_fn);
+    task_spawn(&consumer.task, consumer_fn);
+
+    sem_init(&bus, 1);
+    for (int i = 0; i < 4; i++) {
+        task_spawn(&workers[i].task, worker_fn);
+    }
+
+    sched_run();        // Blinkers run forever
+
+    return (int)consumer.sum;
+}
@@ -0,0 +1,360 @@
+/*
+ * sort.c - Sorting Library and Benchmark
+ *
+ * Demonstrates:
+ *   - Introsort (median-of-3 quicksort, heapsort fallback, insertion sort
+ *     for small runs) with O(n log n) worst case
+ *   - LSD radix sort for 32-bit integer keys (O(n), skips constant digits)
+ *   - A macro generator that specializes the sort for a type and inlines
+ *     the comparison, instead of qsort's indirect call per comparison
+ *   - Cycles-per-element benchmark against bubble_sort and newlib qsort
+ *
+ * Build (compare across presets):
+ *   rv build examples/sort.c --arch 32i --bare -o build/sort_32i.elf
+ *   rv build examples/sort.c --arch 32imac --bare -o build/sort_32imac.elf
+ *   rv build examples/sort.c --arch 32imc_zba_zbb --bare -o build/sort_zbb.elf
+ *   rv build examples/sort.c --arch 64imac --bare -o build/sort_64imac.elf
+ *
+ * Verify the comparison is inlined (no jalr in the sort loops):
+ *   rv dump build/sort_32imac.elf --grep jalr
+ *
+ * Results are left in sort_bench[] (cycles per element, see bench_run).
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+/* ============================================================================
+ * CONFIGURATION
+ * ============================================================================ */
+
+// Runs shorter than this are finished with insertion sort
+#define SORT_INSERTION_THRESHOLD 16
+
+// Benchmark sizes
+#define BENCH_MAX       1024
+
+/* ============================================================================
+ * Type-specialized Sort Generator
+ * ============================================================================
+ *
+ * DEFINE_SORT(prefix, type, less) generates:
+ *   prefix_insertion(type *a, size_t n)
+ *   prefix_heapsort(type *a, size_t n)
+ *   prefix_introsort(type *a, size_t n)
+ *
+ * 'less' is a macro or function taking two values; the compiler inlines it
+ * into the loops, so there is no call per comparison.
+ */
+
+#define SORT_SWAP(type, x, y) do { type _t = (x); (x) = (y); (y) = _t; } while (0)
+
+#define DEFINE_SORT(prefix, type, less)                                        \
+                                                                               \
+static void prefix##_insertion(type *a, size_t n) {                           \
+    for (size_t i = 1; i < n; i++) {                                           \
+        type v = a[i];                                                         \
+        size_t j = i;                                                          \
+        while (j > 0 && less(v, a[j - 1])) {                                   \
+            a[j] = a[j - 1];                                                   \
+            j--;                                                               \
+        }                                                                      \
+        a[j] = v;                                                              \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static void prefix##_sift_down(type *a, size_t root, size_t n) {              \
+    type v = a[root];                                                          \
+    size_t child;                                                              \
+    while ((child = 2 * root + 1) < n) {                                       \
+        if (child + 1 < n && less(a[child], a[child + 1])) {                   \
+            child++;                                                           \
+        }                                                                      \
+        if (!less(v, a[child])) {                                              \
+            break;                                                             \
+        }                                                                      \
+        a[root] = a[child];                                                    \
+        root = child;                                                          \
+    }                                                                          \
+    a[root] = v;                                                               \
+}                                                                              \
+                                                                               \
+static void prefix##_heapsort(type *a, size_t n) {                            \
+    if (n < 2) return;                                                         \
+    for (size_t i = n / 2; i-- > 0; ) {                                        \
+        prefix##_sift_down(a, i, n);                                           \
+    }                                                                          \
+    for (size_t end = n - 1; end > 0; end--) {                                 \
+        SORT_SWAP(type, a[0], a[end]);                                         \
+        prefix##_sift_down(a, 0, end);                                         \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+/* Sort [lo, hi) until runs are short; leaves them for one insertion pass */  \
+static void prefix##_intro_loop(type *a, size_t lo, size_t hi, int depth) {   \
+    while (hi - lo > SORT_INSERTION_THRESHOLD) {                               \
+        if (depth-- == 0) {                                                    \
+            prefix##_heapsort(a + lo, hi - lo);                                \
+            return;                                                            \
+        }                                                                      \
+                                                                               \
+        /* Median of three to a[lo], sentinels at both ends */                \
+        size_t mid = lo + (hi - lo) / 2;                                       \
+        if (less(a[mid], a[lo]))     SORT_SWAP(type, a[mid], a[lo]);           \
+        if (less(a[hi - 1], a[mid])) SORT_SWAP(type, a[hi - 1], a[mid]);       \
+        if (less(a[mid], a[lo]))     SORT_SWAP(type, a[mid], a[lo]);           \
+        SORT_SWAP(type, a[lo], a[mid]);                                        \
+        type pivot = a[lo];                                                    \
+                                                                               \
+        /* Hoare partition */                                                  \
+        size_t i = lo, j = hi;                                                 \
+        for (;;) {                                                             \
+            do { i++; } while (less(a[i], pivot));                             \
+            do { j--; } while (less(pivot, a[j]));                             \
+            if (i >= j) break;                                                 \
+            SORT_SWAP(type, a[i], a[j]);                                       \
+        }                                                                      \
+        SORT_SWAP(type, a[lo], a[j]);                                          \
+                                                                               \
+        /* Recurse into the smaller half, loop on the larger (O(log n) stack) */\
+        if (j - lo < hi - (j + 1)) {                                           \
+            prefix##_intro_loop(a, lo, j, depth);                              \
+            lo = j + 1;                                                        \
+        } else {                                                               \
+            prefix##_intro_loop(a, j + 1, hi, depth);                          \
+            hi = j;                                                            \
+        }                                                                      \
+    }                                                                          \
+}                                                                              \
+                                                                               \
+static void prefix##_introsort(type *a, size_t n) {                           \
+    int depth = 0;                                                             \
+    for (size_t m = n; m > 1; m >>= 1) {                                       \
+        depth += 2;                                                            \
+    }                                                                          \
+    if (n > 1) {                                                               \
+        prefix##_intro_loop(a, 0, n, depth);                                   \
+        prefix##_insertion(a, n);                                              \
+    }                                                                          \
+}
+
+/* ============================================================================
+ * Instantiations
+ * ============================================================================ */
+
+#define LESS_VALUE(x, y)    ((x) < (y))
+
+DEFINE_SORT(sort_i32, int32_t, LESS_VALUE)
+
+/**
+ * Records sorted by key (stable order is not guaranteed by introsort)
+ */
+typedef struct {
+    uint16_t key;
+    uint16_t id;
+} record_t;
+
+#define LESS_RECORD(x, y)   ((x).key < (y).key)
+
+DEFINE_SORT(sort_record, record_t, LESS_RECORD)
+
+/* ============================================================================
+ * LSD Radix Sort (uint32 keys)
+ * ============================================================================ */
+
+/**
+ * Sort n unsigned 32-bit keys using tmp (n elements) as scratch space
+ *
+ * Four passes over 8-bit digits with one 256-entry histogram each. All four
+ * histograms are built in a single read of the input, and a pass is skipped
+ * when every key has the same digit (common for small values).
+ * Stable; result ends up in a.
+ */
+void radix_sort_u32(uint32_t *a, uint32_t *tmp, size_t n) {
+    static uint32_t count[4][256];
+    uint32_t *src = a, *dst = tmp;
+
+    if (n < 2) return;
+
+    for (int d = 0; d < 4; d++) {
+        for (int i = 0; i < 256; i++) {
+            count[d][i] = 0;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        uint32_t v = a[i];
+        count[0][v & 0xFF]++;
+        count[1][(v >> 8) & 0xFF]++;
+        count[2][(v >> 16) & 0xFF]++;
+        count[3][v >> 24]++;
+    }
+
+    for (int d = 0; d < 4; d++) {
+        uint32_t *c = count[d];
+        int shift = d * 8;
+
+        // All keys share this digit: nothing to do
+        if (c[(src[0] >> shift) & 0xFF] == n) {
+            continue;
+        }
+
+        // Counts -> starting offsets
+        uint32_t sum = 0;
+        for (int i = 0; i < 256; i++) {
+            uint32_t t = c[i];
+            c[i] = sum;
+            sum += t;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            uint32_t v = src[i];
+            dst[c[(v >> shift) & 0xFF]++] = v;
+        }
+
+        uint32_t *t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != a) {
+        for (size_t i = 0; i < n; i++) {
+            a[i] = src[i];
+        }
+    }
+}
+
+/**
+ * Signed keys: flip the sign bit so they order correctly as unsigned
+ */
+void radix_sort_i32(int32_t *a, int32_t *tmp, size_t n) {
+    uint32_t *u = (uint32_t *)a;
+    for (size_t i = 0; i < n; i++) u[i] ^= 0x80000000U;
+    radix_sort_u32(u, (uint32_t *)tmp, n);
+    for (size_t i = 0; i < n; i++) u[i] ^= 0x80000000U;
+}
+
+/* ============================================================================
+ * Public Entry Point
+ * ============================================================================ */
+
+/**
+ * Sort int32 array in place
+ * Picks radix sort for large arrays when scratch space is provided.
+ */
+void sort_int32(int32_t *a, int32_t *tmp, size_t n) {
+    if (n <= SORT_INSERTION_THRESHOLD) {
+        sort_i32_insertion(a, n);
+    } else if (tmp && n >= 128) {
+        radix_sort_i32(a, tmp, n);
+    } else {
+        sort_i32_introsort(a, n);
+    }
+}
+
+/* ============================================================================
+ * Benchmark
+ * ============================================================================ */
+
+/**
+ * Baseline from compressed_test.c
+ */
+static void bubble_sort(int32_t *arr, int n) {
+    for (int i = 0; i < n - 1; i++) {
+        for (int j = 0; j < n - i - 1; j++) {
+            if (arr[j] > arr[j + 1]) {
+                int32_t temp = arr[j];
+                arr[j] = arr[j + 1];
+                arr[j + 1] = temp;
+            }
+        }
+    }
+}
+
+static int cmp_i32(const void *x, const void *y) {
+    int32_t a = *(const int32_t *)x;
+    int32_t b = *(const int32_t *)y;
+    return (a > b) - (a < b);
+}
+
+static int32_t bench_data[BENCH_MAX];
+static int32_t bench_work[BENCH_MAX];
+static int32_t bench_tmp[BENCH_MAX];
+
+enum { ALG_BUBBLE, ALG_QSORT, ALG_INSERTION, ALG_INTROSORT, ALG_RADIX, ALG_COUNT };
+
+static const size_t bench_sizes[] = { 16, 64, 256, 1024 };
+#define NUM_SIZES (sizeof(bench_sizes) / sizeof(bench_sizes[0]))
+
+/**
+ * Cycles per element: sort_bench[size index][algorithm]
+ * 0 = skipped (bubble and insertion sort above 256 elements)
+ */
+volatile uint32_t sort_bench[NUM_SIZES][ALG_COUNT];
+volatile uint32_t sort_errors;
+
+static int is_sorted(const int32_t *a, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        if (a[i - 1] > a[i]) return 0;
+    }
+    return 1;
+}
+
+static void bench_run(void) {
+    for (size_t s = 0; s < NUM_SIZES; s++) {
+        size_t n = bench_sizes[s];
+
+        for (size_t i = 0; i < n; i++) {
+            bench_data[i] = (int32_t)rng_next();
+        }
+
+        for (int alg = 0; alg < ALG_COUNT; alg++) {
+            if ((alg == ALG_BUBBLE || alg == ALG_INSERTION) && n > 256) {
+                continue;
+            }
+            for (size_t i = 0; i < n; i++) {
+                bench_work[i] = bench_data[i];
+            }
+
+            unsigned long start = read_mcycle();
+            switch (alg) {
+                case ALG_BUBBLE:    bubble_sort(bench_work, (int)n); break;
+                case ALG_QSORT:     qsort(bench_work, n, sizeof(int32_t), cmp_i32); break;
+                case ALG_INSERTION: sort_i32_insertion(bench_work, n); break;
+                case ALG_INTROSORT: sort_i32_introsort(bench_work, n); break;
+                case ALG_RADIX:     radix_sort_i32(bench_work, bench_tmp, n); break;
+            }
+            unsigned long cycles = read_mcycle() - start;
+
+            sort_bench[s][alg] = (uint32_t)(cycles / n);
+            if (!is_sorted(bench_work, n)) {
+                sort_errors++;
+            }
+        }
+    }
+}
+
+/* ============================================================================
+ * Main - Exercise all functions
+ * ============================================================================ */
+
+int main(void) {
+    volatile int result = 0;
+
+    // Same input as bubble_sort in compressed_test.c
+    int32_t unsorted[] = {5, 3, 8, 1, 9, 2, 7, 4, 6, 0};
+    sort_int32(unsorted, 0, 10);
+    result += unsorted[0];  // Should be 0 after sort
+    result += unsorted[9];  // Should be 9 after sort
+
+    // Records by key
+    record_t recs[] = {{30, 0}, {10, 1}, {20, 2}, {10, 3}};
+    sort_record_introsort(recs, 4);
+    result += recs[0].key;  // 10
+
+    bench_run();
+    result += sort_errors;
+
+    return result;
+}
@@ -0,0 +1,456 @@
+/*
+ * uart.c - Interrupt-driven UART Driver with Double-buffered Blocks
+ *
+ * Demonstrates:
+ *   - One driver for the SiFive UART and the 16550 register layouts
+ *   - TX/RX ring buffers serviced from the PLIC external interrupt
+ *   - Batched FIFO fills (a whole FIFO per interrupt, no per-byte polling)
+ *   - DMA-style double buffering: the application fills one block while
+ *     the interrupt handler transmits the other
+ *
+ * Build:
+ *   rv build examples/uart.c --arch 32imac --bare
+ *
+ * Verify instructions:
+ *   rv dump build/uart.elf --grep mret
+ *   rv dump build/uart.elf --grep wfi
+ *
+ * Default target is the QEMU virt machine (16550 at 0x10000000, IRQ 10),
+ * which matches the memory layout of the bundled linker scripts.
+ * For a SiFive FE310 set UART_TYPE to UART_SIFIVE.
+ */
+
+#include <stdint.h>
+
+/* ============================================================================
+ * CONFIGURATION - Adjust these for your specific board/MCU
+ * ============================================================================ */
+
+#define UART_SIFIVE     1
+#define UART_16550      2
+
+#ifndef UART_TYPE
+#define UART_TYPE       UART_16550
+#endif
+
+#if UART_TYPE == UART_SIFIVE
+// SiFive FE310 UART0
+#define UART_BASE       0x10013000
+#define UART_IRQ        3
+#define UART_CLOCK_HZ   16000000
+#define UART_FIFO_DEPTH 8
+#else
+// QEMU virt / generic 16550 (registers are byte-spaced)
+#define UART_BASE       0x10000000
+#define UART_IRQ        10
+#define UART_CLOCK_HZ   3686400
+#define UART_FIFO_DEPTH 16
+#endif
+
+#define UART_BAUD       115200
+
+// PLIC (Platform-Level Interrupt Controller), hart 0 machine context
+#define PLIC_BASE       0x0C000000
+#define PLIC_PRIORITY   ((volatile uint32_t *)(PLIC_BASE + 0x000000))
+#define PLIC_ENABLE     ((volatile uint32_t *)(PLIC_BASE + 0x002000))
+#define PLIC_THRESHOLD  (*(volatile uint32_t *)(PLIC_BASE + 0x200000))
+#define PLIC_CLAIM      (*(volatile uint32_t *)(PLIC_BASE + 0x200004))
+
+// Buffer sizes (ring sizes must be powers of 2)
+#define TX_RING_SIZE    256
+#define RX_RING_SIZE    64
+#define TX_BLOCK_SIZE   128
+
+// CSR bits
+#define MSTATUS_MIE     (1U << 3)
+#define MIE_MEIE        (1U << 11)
+#define MCAUSE_MEI      0xB             // Cause code, with the interrupt bit (MSB) set
+
+/* ============================================================================
+ * Register Layer
+ * ============================================================================
+ *
+ * Each layout provides the same five operations. tx_room() returns how many
+ * bytes can be written without checking status again, which is what lets
+ * the interrupt handler fill the FIFO in one batch.
+ */
+
+#if UART_TYPE == UART_SIFIVE
+
+#define UART_REG(off)   (*(volatile uint32_t *)(UART_BASE + (off)))
+#define UART_TXDATA     UART_REG(0x00)
+#define UART_RXDATA     UART_REG(0x04)
+#define UART_TXCTRL     UART_REG(0x08)
+#define UART_RXCTRL     UART_REG(0x0C)
+#define UART_IE         UART_REG(0x10)
+#define UART_IP         UART_REG(0x14)
+#define UART_DIV        UART_REG(0x18)
+
+#define UART_IE_TXWM    (1U << 0)
+#define UART_IE_RXWM    (1U << 1)
+#define UART_FLAG       (1U << 31)  // txdata: FIFO full, rxdata: FIFO empty
+
+static void uart_hw_init(void) {
+    UART_DIV = UART_CLOCK_HZ / UART_BAUD - 1;
+    UART_TXCTRL = 1 | (1U << 16);   // txen, watermark: interrupt when FIFO empty
+    UART_RXCTRL = 1;                // rxen, watermark 0: interrupt on any byte
+    UART_IE = UART_IE_RXWM;
+}
+
+static inline uint32_t uart_hw_tx_room(void) {
+    // The TX watermark interrupt fires only when the FIFO is empty
+    return (UART_IP & UART_IE_TXWM) ? UART_FIFO_DEPTH : 0;
+}
+
+static inline void uart_hw_put(uint8_t c) {
+    UART_TXDATA = c;
+}
+
+static inline int uart_hw_get(uint8_t *c) {
+    uint32_t v = UART_RXDATA;
+    *c = (uint8_t)v;
+    return !(v & UART_FLAG);
+}
+
+static inline void uart_hw_tx_irq(int enable) {
+    if (enable) UART_IE |= UART_IE_TXWM;
+    else        UART_IE &= ~UART_IE_TXWM;
+}
+
+#else  /* UART_16550 */
+
+#define UART_REG(off)   (*(volatile uint8_t *)(UART_BASE + (off)))
+#define UART_RBR        UART_REG(0)     // Receive buffer (read)
+#define UART_THR        UART_REG(0)     // Transmit holding (write)
+#define UART_DLL        UART_REG(0)     // Divisor latch low (DLAB=1)
+#define UART_IER        UART_REG(1)     // Interrupt enable
+#define UART_DLM        UART_REG(1)     // Divisor latch high (DLAB=1)
+#define UART_FCR        UART_REG(2)     // FIFO control (write)
+#define UART_LCR        UART_REG(3)     // Line control
+#define UART_LSR        UART_REG(5)     // Line status
+
+#define IER_ERBFI       (1U << 0)       // RX data available
+#define IER_ETBEI       (1U << 1)       // TX holding register empty
+#define LSR_DR          (1U << 0)
+#define LSR_THRE        (1U << 5)
+
+static void uart_hw_init(void) {
+    uint32_t div = UART_CLOCK_HZ / (16 * UART_BAUD);
+
+    UART_IER = 0;
+    UART_LCR = 0x80;                // DLAB=1
+    UART_DLL = div & 0xFF;
+    UART_DLM = (div >> 8) & 0xFF;
+    UART_LCR = 0x03;                // 8N1, DLAB=0
+    UART_FCR = 0x07;                // Enable and reset both FIFOs
+    UART_IER = IER_ERBFI;
+}
+
+static inline uint32_t uart_hw_tx_room(void) {
+    // THRE means the whole TX FIFO is empty
+    return (UART_LSR & LSR_THRE) ? UART_FIFO_DEPTH : 0;
+}
+
+static inline void uart_hw_put(uint8_t c) {
+    UART_THR = c;
+}
+
+static inline int uart_hw_get(uint8_t *c) {
+    if (!(UART_LSR & LSR_DR)) {
+        return 0;
+    }
+    *c = UART_RBR;
+    return 1;
+}
+
+static inline void uart_hw_tx_irq(int enable) {
+    if (enable) UART_IER |= IER_ETBEI;
+    else        UART_IER &= ~IER_ETBEI;
+}
+
+#endif /* UART_TYPE */
+
+/* ============================================================================
+ * Driver State
+ * ============================================================================
+ *
+ * Rings are single-producer/single-consumer: the application owns the head
+ * of the TX ring and the tail of the RX ring, the ISR owns the others, so
+ * no locking is needed on a single hart.
+ *
+ * TX blocks: the application writes blk_submitted, the ISR writes blk_done.
+ * Each submitted block remembers the TX ring head at submit time (its
+ * "mark"), so ring bytes and blocks go out in the order they were queued.
+ */
+
+static uint8_t tx_ring[TX_RING_SIZE];
+static volatile uint32_t tx_head;       // Written by application
+static volatile uint32_t tx_tail;       // Written by ISR
+
+static uint8_t rx_ring[RX_RING_SIZE];
+static volatile uint32_t rx_head;       // Written by ISR
+static volatile uint32_t rx_tail;       // Written by application
+static volatile uint32_t rx_overruns;
+
+typedef struct {
+    uint8_t data[TX_BLOCK_SIZE];
+    uint32_t len;
+    uint32_t mark;                      // tx_head when submitted
+} tx_block_t;
+
+static tx_block_t tx_blocks[2];
+static volatile uint32_t blk_submitted; // Written by application
+static volatile uint32_t blk_done;      // Written by ISR
+static uint32_t blk_pos;                // ISR: bytes of current block sent
+
+/* ============================================================================
+ * Interrupt Handler
+ * ============================================================================ */
+
+/**
+ * Service the UART: drain RX into the ring, refill the TX FIFO
+ */
+static void uart_isr(void) {
+    uint8_t c;
+
+    while (uart_hw_get(&c)) {
+        uint32_t head = rx_head;
+        if (head - rx_tail < RX_RING_SIZE) {
+            rx_ring[head & (RX_RING_SIZE - 1)] = c;
+            rx_head = head + 1;
+        } else {
+            rx_overruns++;
+        }
+    }
+
+    uint32_t room = uart_hw_tx_room();
+    uint32_t tail = tx_tail;
+
+    while (room) {
+        if (blk_done != blk_submitted) {
+            tx_block_t *blk = &tx_blocks[blk_done & 1];
+
+            // Ring bytes queued before this block go first
+            if (tail != blk->mark) {
+                uart_hw_put(tx_ring[tail++ & (TX_RING_SIZE - 1)]);
+                room--;
+                continue;
+            }
+
+            uint32_t n = blk->len - blk_pos;
+            if (n > room) n = room;
+            for (uint32_t i = 0; i < n; i++) {
+                uart_hw_put(blk->data[blk_pos + i]);
+            }
+            blk_pos += n;
+            room -= n;
+
+            if (blk_pos == blk->len) {
+                blk_pos = 0;
+                blk_done = blk_done + 1;    // Hand the block back
+            }
+        } else if (tail != tx_head) {
+            uart_hw_put(tx_ring[tail++ & (TX_RING_SIZE - 1)]);
+            room--;
+        } else {
+            break;
+        }
+    }
+    tx_tail = tail;
+
+    // Nothing left to send: stop TX interrupts until more data is queued
+    if (tail == tx_head && blk_done == blk_submitted) {
+        uart_hw_tx_irq(0);
+    }
+}
+
+/**
+ * Machine trap handler: claim the PLIC source and dispatch
+ * Exceptions (mcause MSB clear) would return onto the faulting
+ * instruction and trap again, so they park here for the debugger
+ * (mepc/mcause/mtval still describe the fault).
+ */
+__attribute__((interrupt("machine"), aligned(4)))
+void trap_isr(void) {
+    unsigned long mcause;
+    __asm__ volatile ("csrr %0, mcause" : "=r"(mcause));
+
+    if (!(mcause >> (__riscv_xlen - 1))) {
+        for (;;) {
+        }
+    }
+    if ((mcause & 0xFF) == MCAUSE_MEI) {
+        uint32_t irq = PLIC_CLAIM;
+        if (irq == UART_IRQ) {
+            uart_isr();
+        }
+        PLIC_CLAIM = irq;                   // Complete
+    }
+}
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+/**
+ * Initialize the UART, route its interrupt through the PLIC and enable
+ * machine external interrupts
+ */
+void uart_init(void) {
+    uart_hw_init();
+
+    PLIC_PRIORITY[UART_IRQ] = 1;
+    PLIC_ENABLE[UART_IRQ / 32] |= 1U << (UART_IRQ % 32);
+    PLIC_THRESHOLD = 0;
+
+    __asm__ volatile ("csrw mtvec, %0" : : "r"(trap_isr));
+    __asm__ volatile ("csrs mie, %0" : : "r"(MIE_MEIE));
+    __asm__ volatile ("csrs mstatus, %0" : : "r"(MSTATUS_MIE));
+}
+
+/**
+ * Queue bytes for transmission (non-blocking)
+ * Returns the number of bytes accepted; the rest did not fit in the ring.
+ */
+uint32_t uart_write(const void *buf, uint32_t len) {
+    const uint8_t *p = (const uint8_t *)buf;
+    uint32_t head = tx_head;
+    uint32_t free = TX_RING_SIZE - (head - tx_tail);
+
+    if (len > free) {
+        len = free;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        tx_ring[(head + i) & (TX_RING_SIZE - 1)] = p[i];
+    }
+
+    __asm__ volatile ("" ::: "memory");     // Data before index
+    tx_head = head + len;
+    uart_hw_tx_irq(1);
+    return len;
+}
+
+/**
+ * Queue a NUL-terminated string
+ */
+uint32_t uart_puts(const char *s) {
+    uint32_t len = 0;
+    while (s[len]) {
+        len++;
+    }
+    return uart_write(s, len);
+}
+
+/**
+ * Read up to len received bytes (non-blocking)
+ * Returns the number of bytes copied.
+ */
+uint32_t uart_read(void *buf, uint32_t len) {
+    uint8_t *p = (uint8_t *)buf;
+    uint32_t tail = rx_tail;
+    uint32_t avail = rx_head - tail;
+
+    if (len > avail) {
+        len = avail;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        p[i] = rx_ring[(tail + i) & (RX_RING_SIZE - 1)];
+    }
+
+    __asm__ volatile ("" ::: "memory");
+    rx_tail = tail + len;
+    return len;
+}
+
+/**
+ * Get the block the application may fill next
+ * Returns NULL while both blocks are queued or in flight.
+ */
+uint8_t *uart_tx_block_acquire(void) {
+    uint32_t sub = blk_submitted;
+    if (sub - blk_done >= 2) {
+        return 0;
+    }
+    return tx_blocks[sub & 1].data;
+}
+
+/**
+ * Hand the acquired block (len bytes) to the interrupt handler
+ * The block is sent without copying, after any ring bytes queued earlier.
+ */
+void uart_tx_block_submit(uint32_t len) {
+    uint32_t sub = blk_submitted;
+    tx_block_t *blk = &tx_blocks[sub & 1];
+
+    blk->len = (len > TX_BLOCK_SIZE) ? TX_BLOCK_SIZE : len;
+    blk->mark = tx_head;
+
+    __asm__ volatile ("" ::: "memory");     // Block before counter
+    if (blk->len) {
+        blk_submitted = sub + 1;
+        uart_hw_tx_irq(1);
+    }
+}
+
+/**
+ * True once every queued byte and block has been handed to the FIFO
+ */
+int uart_tx_idle(void) {
+    return tx_tail == tx_head && blk_done == blk_submitted;
+}
+
+/* ============================================================================
+ * Main - Serial logger with echo
+ * ============================================================================ */
+
+/**
+ * Format an unsigned number in decimal, returns number of characters
+ */
+static uint32_t fmt_u32(uint8_t *out, uint32_t val) {
+    uint8_t tmp[10];
+    uint32_t n = 0;
+    do {
+        tmp[n++] = '0' + (val % 10);
+        val /= 10;
+    } while (val);
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+int main(void) {
+    uart_init();
+    uart_puts("Hello, RISC-V!\r\n");
+
+    uint32_t line = 0;
+
+    while (1) {
+        // Log lines are built in place in a free block, then handed off
+        uint8_t *blk = uart_tx_block_acquire();
+        if (blk && line < 10) {
+            static const char prefix[] = "log line ";
+            uint32_t n = 0;
+            for (uint32_t i = 0; i < sizeof(prefix) - 1; i++) {
+                blk[n++] = prefix[i];
+            }
+            n += fmt_u32(blk + n, line++);
+            blk[n++] = '\r';
+            blk[n++] = '\n';
+            uart_tx_block_submit(n);
+            continue;
+        }
+
+        // Echo whatever arrived
+        uint8_t buf[16];
+        uint32_t n = uart_read(buf, sizeof(buf));
+        if (n) {
+            uart_write(buf, n);
+        }
+
+        // Sleep until the next UART interrupt
+        __asm__ volatile ("wfi");
+    }
+
+    return 0;  // Never reached
+}
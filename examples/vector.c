@@ -0,0 +1,457 @@
+/*
+ * vector.c - RISC-V Vector (RVV) Kernels and Benchmark
+ *
+ * Demonstrates:
+ *   - Strip-mined loops: vsetvl picks how many elements each iteration
+ *     handles, so one binary runs on any VLEN and needs no tail loop
+ *   - Intrinsic versions (<riscv_vector.h>) of the example kernels:
+ *     simple_memcpy, simple_strlen (fault-only-first loads), dot_product_3d
+ *     and moving_average (reductions), and an odd-even transposition sort
+ *     (strided loads, vmin/vmax) replacing bubble_sort
+ *   - The same kernels written for the autovectorizer (restrict pointers,
+ *     counted loops, branchless inner loops), which GCC turns into RVV
+ *     code on its own at -O2/-O3
+ *   - Cycle benchmark of scalar, autovectorized and intrinsic versions
+ *
+ * Build (vector presets, and a scalar build for comparison):
+ *   rv build examples/vector.c --arch 32imafdcv --opt O3 --bare -o build/vector_v.elf
+ *   rv build examples/vector.c --arch 32imafc_zve32f --opt O3 --bare -o build/vector_zve32f.elf
+ *   rv build examples/vector.c --arch 32imac_zve32x --opt O3 --bare -o build/vector_zve32x.elf
+ *   rv build examples/vector.c --arch 32imafdc --opt O3 --bare -o build/vector_scalar.elf
+ *
+ * Run on the simulator at different vector lengths:
+ *   rv run build/vector_v.elf --vlen 128
+ *   rv run build/vector_v.elf --vlen 512
+ *   rv run build/vector_zve32f.elf --vlen 32
+ *
+ * main returns the number of kernels whose result differed from the scalar
+ * version ('rv run' stops with exit(0) when all agree), so every run above
+ * doubles as a check at that VLEN.
+ *
+ * Zve32x has no vector floating point: the float kernels stay scalar there.
+ * Results are left in vector_bench[] (cycles per call, see bench_run).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bench.h"
+
+#if defined(__riscv_vector)
+#include <riscv_vector.h>
+#define HAVE_RVV        1
+#define HAVE_RVV_FLOAT  (__riscv_v_elen_fp >= 32)
+#else
+#define HAVE_RVV        0
+#define HAVE_RVV_FLOAT  0
+#endif
+
+/* ============================================================================
+ * CONFIGURATION
+ * ============================================================================ */
+
+// Benchmark sizes
+#define BENCH_BYTES     1024
+#define BENCH_STRLEN    255
+#define BENCH_VEC3      64
+#define BENCH_SAMPLES   256
+#define BENCH_SORT      64
+
+// Keep the baselines scalar even when the build targets V
+#define SCALAR __attribute__((noinline, optimize("no-tree-vectorize")))
+
+/* ============================================================================
+ * Scalar Baselines (from compressed_test.c and float_test.c)
+ * ============================================================================ */
+
+SCALAR void *simple_memcpy(void *dest, const void *src, uint32_t n) {
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
+
+    while (n--) {
+        *d++ = *s++;
+    }
+
+    return dest;
+}
+
+SCALAR uint32_t simple_strlen(const char *s) {
+    uint32_t len = 0;
+    while (*s++) {
+        len++;
+    }
+    return len;
+}
+
+SCALAR float dot_product_3d(const float *a, const float *b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+SCALAR float moving_average(const float *samples, int count) {
+    float sum = 0.0f;
+    for (int i = 0; i < count; i++) {
+        sum += samples[i];
+    }
+    return sum / (float)count;
+}
+
+SCALAR void bubble_sort(int32_t *arr, int n) {
+    for (int i = 0; i < n - 1; i++) {
+        for (int j = 0; j < n - i - 1; j++) {
+            if (arr[j] > arr[j + 1]) {
+                int32_t temp = arr[j];
+                arr[j] = arr[j + 1];
+                arr[j + 1] = temp;
+            }
+        }
+    }
+}
+
+/* ============================================================================
+ * Autovectorizer-friendly Forms
+ * ============================================================================
+ *
+ * Plain C the compiler can vectorize by itself: restrict promises the
+ * buffers don't overlap (no runtime alias check), the trip count is known
+ * before the loop starts, and the loop bodies have no branches. strlen has
+ * no such form: its loop exit depends on data the compiler may not read
+ * ahead of, which is what fault-only-first loads solve below.
+ */
+
+__attribute__((noinline))
+void *auto_memcpy(void *restrict dest, const void *restrict src, size_t n) {
+    uint8_t *restrict d = dest;
+    const uint8_t *restrict s = src;
+    for (size_t i = 0; i < n; i++) {
+        d[i] = s[i];
+    }
+    return dest;
+}
+
+/**
+ * Dot products of 'count' 3D vectors at once (one call per vector is too
+ * short to vectorize)
+ */
+__attribute__((noinline))
+void auto_dot_product_3d(const float *restrict a, const float *restrict b,
+                         float *restrict out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = a[3 * i] * b[3 * i] + a[3 * i + 1] * b[3 * i + 1] + a[3 * i + 2] * b[3 * i + 2];
+    }
+}
+
+/**
+ * In-order float sum: vectorized with ordered reductions (vfredosum), no
+ * -ffast-math needed
+ */
+__attribute__((noinline))
+float auto_moving_average(const float *restrict samples, int count) {
+    float sum = 0.0f;
+    for (int i = 0; i < count; i++) {
+        sum += samples[i];
+    }
+    return sum / (float)count;
+}
+
+/**
+ * Odd-even transposition sort: each phase compares disjoint pairs, so the
+ * inner loop has no dependences between iterations (unlike bubble sort)
+ */
+__attribute__((noinline))
+void auto_sort(int32_t *restrict a, size_t n) {
+    for (size_t pass = 0; pass < n; pass++) {
+        int32_t *restrict p = a + (pass & 1);
+        size_t pairs = (n - (pass & 1)) / 2;
+        for (size_t i = 0; i < pairs; i++) {
+            int32_t lo = p[2 * i];
+            int32_t hi = p[2 * i + 1];
+            p[2 * i] = lo < hi ? lo : hi;
+            p[2 * i + 1] = lo < hi ? hi : lo;
+        }
+    }
+}
+
+/* ============================================================================
+ * RVV Intrinsics
+ * ============================================================================ */
+
+#if HAVE_RVV
+
+/**
+ * memcpy with LMUL=8: one vle8/vse8 pair moves 8 registers (VLEN bytes)
+ */
+__attribute__((noinline))
+void *rvv_memcpy(void *dest, const void *src, size_t n) {
+    uint8_t *d = dest;
+    const uint8_t *s = src;
+    while (n > 0) {
+        size_t vl = __riscv_vsetvl_e8m8(n);
+        __riscv_vse8_v_u8m8(d, __riscv_vle8_v_u8m8(s, vl), vl);
+        d += vl;
+        s += vl;
+        n -= vl;
+    }
+    return dest;
+}
+
+/**
+ * strlen with fault-only-first loads: vle8ff stops at the first element
+ * that would fault (past the end of memory) instead of trapping, and
+ * reports how many it loaded in vl
+ */
+__attribute__((noinline))
+size_t rvv_strlen(const char *str) {
+    const uint8_t *s = (const uint8_t *)str;
+    size_t vlmax = __riscv_vsetvlmax_e8m1();
+    for (;;) {
+        size_t vl;
+        vuint8m1_t v = __riscv_vle8ff_v_u8m1(s, &vl, vlmax);
+        long zero = __riscv_vfirst_m_b8(__riscv_vmseq_vx_u8m1_b8(v, 0, vl), vl);
+        if (zero >= 0) {
+            return (size_t)(s - (const uint8_t *)str) + (size_t)zero;
+        }
+        s += vl;
+    }
+}
+
+/**
+ * Odd-even transposition sort: strided loads gather the left and right
+ * element of every pair, vmin/vmax order them, a pass with no swaps ends it
+ */
+__attribute__((noinline))
+void rvv_sort(int32_t *a, size_t n) {
+    for (size_t pass = 0; pass < n; pass++) {
+        size_t swaps = 0;
+        for (size_t phase = 0; phase < 2; phase++) {
+            int32_t *p = a + phase;
+            size_t pairs = (n - phase) / 2;
+            while (pairs > 0) {
+                size_t vl = __riscv_vsetvl_e32m4(pairs);
+                vint32m4_t lo = __riscv_vlse32_v_i32m4(p, 8, vl);
+                vint32m4_t hi = __riscv_vlse32_v_i32m4(p + 1, 8, vl);
+                swaps += __riscv_vcpop_m_b8(__riscv_vmslt_vv_i32m4_b8(hi, lo, vl), vl);
+                __riscv_vsse32_v_i32m4(p, 8, __riscv_vmin_vv_i32m4(lo, hi, vl), vl);
+                __riscv_vsse32_v_i32m4(p + 1, 8, __riscv_vmax_vv_i32m4(lo, hi, vl), vl);
+                p += 2 * vl;
+                pairs -= vl;
+            }
+        }
+        if (swaps == 0) {
+            break;
+        }
+    }
+}
+
+#endif /* HAVE_RVV */
+
+#if HAVE_RVV_FLOAT
+
+/**
+ * 3-element dot product: one vfmul and an unordered sum (vfredusum).
+ * LMUL=4 holds the 3 floats at any VLEN (4 lanes at Zve32f's minimum of 32).
+ */
+__attribute__((noinline))
+float rvv_dot_product_3d(const float *a, const float *b) {
+    size_t vl = __riscv_vsetvl_e32m4(3);
+    vfloat32m4_t prod = __riscv_vfmul_vv_f32m4(__riscv_vle32_v_f32m4(a, vl),
+                                               __riscv_vle32_v_f32m4(b, vl), vl);
+    vfloat32m1_t sum = __riscv_vfredusum_vs_f32m4_f32m1(prod, __riscv_vfmv_s_f_f32m1(0.0f, 1), vl);
+    return __riscv_vfmv_f_s_f32m1_f32(sum);
+}
+
+/**
+ * Average: per-lane partial sums (the _tu form leaves lanes past a short
+ * last strip alone), reduced once at the end. This adds in a different
+ * order than the scalar loop, so results can differ in the last bits.
+ */
+__attribute__((noinline))
+float rvv_moving_average(const float *samples, int count) {
+    size_t vlmax = __riscv_vsetvlmax_e32m4();
+    vfloat32m4_t acc = __riscv_vfmv_v_f_f32m4(0.0f, vlmax);
+    for (size_t n = (size_t)count; n > 0; ) {
+        size_t vl = __riscv_vsetvl_e32m4(n);
+        acc = __riscv_vfadd_vv_f32m4_tu(acc, acc, __riscv_vle32_v_f32m4(samples, vl), vl);
+        samples += vl;
+        n -= vl;
+    }
+    vfloat32m1_t sum = __riscv_vfredusum_vs_f32m4_f32m1(acc, __riscv_vfmv_s_f_f32m1(0.0f, 1), vlmax);
+    return __riscv_vfmv_f_s_f32m1_f32(sum) / (float)count;
+}
+
+#endif /* HAVE_RVV_FLOAT */
+
+/* ============================================================================
+ * Benchmark
+ * ============================================================================ */
+
+enum { K_MEMCPY, K_STRLEN, K_DOT, K_AVERAGE, K_SORT, KERNEL_COUNT };
+enum { IMPL_SCALAR, IMPL_AUTO, IMPL_RVV, IMPL_COUNT };
+
+/**
+ * Cycles per call: vector_bench[kernel][implementation]
+ * 0 = not built for this architecture
+ */
+volatile uint32_t vector_bench[KERNEL_COUNT][IMPL_COUNT];
+volatile uint32_t vector_errors;
+
+static uint8_t bench_src[BENCH_BYTES];
+static uint8_t bench_dst[BENCH_BYTES];
+static char bench_str[BENCH_STRLEN + 1];
+static float bench_a[3 * BENCH_VEC3];
+static float bench_b[3 * BENCH_VEC3];
+static float bench_dots[BENCH_VEC3];
+static float bench_samples[BENCH_SAMPLES];
+static int32_t bench_data[BENCH_SORT];
+static int32_t bench_work[BENCH_SORT];
+
+static void bench_init(void) {
+    for (size_t i = 0; i < BENCH_BYTES; i++) {
+        bench_src[i] = (uint8_t)rng_next();
+    }
+    for (size_t i = 0; i < BENCH_STRLEN; i++) {
+        bench_str[i] = (char)('a' + i % 26);
+    }
+    // Small integers: every implementation's sums are exact
+    for (size_t i = 0; i < 3 * BENCH_VEC3; i++) {
+        bench_a[i] = (float)(rng_next() % 16);
+        bench_b[i] = (float)(rng_next() % 16);
+    }
+    for (size_t i = 0; i < BENCH_SAMPLES; i++) {
+        bench_samples[i] = (float)(rng_next() % 1000);
+    }
+    for (size_t i = 0; i < BENCH_SORT; i++) {
+        bench_data[i] = (int32_t)rng_next();
+    }
+}
+
+static void check_copy(void) {
+    for (size_t i = 0; i < BENCH_BYTES; i++) {
+        if (bench_dst[i] != bench_src[i]) {
+            vector_errors++;
+            break;
+        }
+    }
+    for (size_t i = 0; i < BENCH_BYTES; i++) {
+        bench_dst[i] = 0;
+    }
+}
+
+static void check_sorted(void) {
+    for (size_t i = 1; i < BENCH_SORT; i++) {
+        if (bench_work[i - 1] > bench_work[i]) {
+            vector_errors++;
+            break;
+        }
+    }
+}
+
+static void reset_sort(void) {
+    for (size_t i = 0; i < BENCH_SORT; i++) {
+        bench_work[i] = bench_data[i];
+    }
+}
+
+static void bench_run(void) {
+    unsigned long start;
+    float expect_dot = 0.0f, dot;
+    float expect_average, average;
+
+    bench_init();
+
+    // memcpy
+    start = read_mcycle();
+    simple_memcpy(bench_dst, bench_src, BENCH_BYTES);
+    vector_bench[K_MEMCPY][IMPL_SCALAR] = (uint32_t)(read_mcycle() - start);
+    check_copy();
+    start = read_mcycle();
+    auto_memcpy(bench_dst, bench_src, BENCH_BYTES);
+    vector_bench[K_MEMCPY][IMPL_AUTO] = (uint32_t)(read_mcycle() - start);
+    check_copy();
+#if HAVE_RVV
+    start = read_mcycle();
+    rvv_memcpy(bench_dst, bench_src, BENCH_BYTES);
+    vector_bench[K_MEMCPY][IMPL_RVV] = (uint32_t)(read_mcycle() - start);
+    check_copy();
+#endif
+
+    // strlen
+    start = read_mcycle();
+    if (simple_strlen(bench_str) != BENCH_STRLEN) vector_errors++;
+    vector_bench[K_STRLEN][IMPL_SCALAR] = (uint32_t)(read_mcycle() - start);
+#if HAVE_RVV
+    start = read_mcycle();
+    if (rvv_strlen(bench_str) != BENCH_STRLEN) vector_errors++;
+    vector_bench[K_STRLEN][IMPL_RVV] = (uint32_t)(read_mcycle() - start);
+#endif
+
+    // Dot products over all BENCH_VEC3 vector pairs
+    start = read_mcycle();
+    for (size_t i = 0; i < BENCH_VEC3; i++) {
+        expect_dot += dot_product_3d(&bench_a[3 * i], &bench_b[3 * i]);
+    }
+    vector_bench[K_DOT][IMPL_SCALAR] = (uint32_t)(read_mcycle() - start);
+    start = read_mcycle();
+    auto_dot_product_3d(bench_a, bench_b, bench_dots, BENCH_VEC3);
+    vector_bench[K_DOT][IMPL_AUTO] = (uint32_t)(read_mcycle() - start);
+    dot = 0.0f;
+    for (size_t i = 0; i < BENCH_VEC3; i++) {
+        dot += bench_dots[i];
+    }
+    if (dot != expect_dot) vector_errors++;
+#if HAVE_RVV_FLOAT
+    start = read_mcycle();
+    dot = 0.0f;
+    for (size_t i = 0; i < BENCH_VEC3; i++) {
+        dot += rvv_dot_product_3d(&bench_a[3 * i], &bench_b[3 * i]);
+    }
+    vector_bench[K_DOT][IMPL_RVV] = (uint32_t)(read_mcycle() - start);
+    if (dot != expect_dot) vector_errors++;
+#endif
+
+    // Moving average
+    start = read_mcycle();
+    expect_average = moving_average(bench_samples, BENCH_SAMPLES);
+    vector_bench[K_AVERAGE][IMPL_SCALAR] = (uint32_t)(read_mcycle() - start);
+    start = read_mcycle();
+    average = auto_moving_average(bench_samples, BENCH_SAMPLES);
+    vector_bench[K_AVERAGE][IMPL_AUTO] = (uint32_t)(read_mcycle() - start);
+    if (average != expect_average) vector_errors++;
+#if HAVE_RVV_FLOAT
+    start = read_mcycle();
+    average = rvv_moving_average(bench_samples, BENCH_SAMPLES);
+    vector_bench[K_AVERAGE][IMPL_RVV] = (uint32_t)(read_mcycle() - start);
+    if (average != expect_average) vector_errors++;
+#endif
+
+    // Sort
+    reset_sort();
+    start = read_mcycle();
+    bubble_sort(bench_work, BENCH_SORT);
+    vector_bench[K_SORT][IMPL_SCALAR] = (uint32_t)(read_mcycle() - start);
+    check_sorted();
+    reset_sort();
+    start = read_mcycle();
+    auto_sort(bench_work, BENCH_SORT);
+    vector_bench[K_SORT][IMPL_AUTO] = (uint32_t)(read_mcycle() - start);
+    check_sorted();
+#if HAVE_RVV
+    reset_sort();
+    start = read_mcycle();
+    rvv_sort(bench_work, BENCH_SORT);
+    vector_bench[K_SORT][IMPL_RVV] = (uint32_t)(read_mcycle() - start);
+    check_sorted();
+#endif
+}
+
+/* ============================================================================
+ * Main - Exercise all functions
+ * ============================================================================ */
+
+int main(void) {
+    volatile int result = 0;
+
+    bench_run();
+    result += vector_errors;
+
+    return result;
+}
@@ -0,0 +1,468 @@
+/*
+ * zbs_zbc_zicond.c - Single-Bit, Carry-Less Multiply and Conditional-Zero Kernels
+ *
+ * Demonstrates:
+ *   - Zbs (Single-Bit): bset, bclr, binv, bext for GPIO masks and bitmaps
+ *     (bitmap sieve, slot allocator)
+ *   - Zbc (Carry-Less Multiply): clmul/clmulr CRC32, one XLEN-bit word
+ *     folded per step with a Barrett reduction instead of a table
+ *   - Zicond (Conditional Zero): czero.eqz/czero.nez branchless selects
+ *     (branchless binary search, blend)
+ *   - Cycle benchmark of each kernel, compared against the Zbb-only build
+ *
+ * Build (the extension build, and the Zbb-only build for comparison):
+ *   rv build examples/zbs_zbc_zicond.c --arch 32imac_zba_zbb_zbc_zbs_zicond --bare -o build/bitops.elf
+ *   rv build examples/zbs_zbc_zicond.c --arch 32imac_zba_zbb --bare -o build/bitops_zbb.elf
+ *
+ * Compare the kernels on the simulator:
+ *   rv run build/bitops.elf -F crc32_update -F sieve_count -F lower_bound -F blend
+ *   rv run build/bitops_zbb.elf -F crc32_update -F sieve_count -F lower_bound -F blend
+ *
+ * Verify instructions:
+ *   rv dump build/bitops.elf --grep clmul
+ *   rv dump build/bitops.elf --grep bset
+ *   rv dump build/bitops.elf --grep czero
+ *
+ * Results are also left in bitops_bench[] (cycles per kernel, see bench_run).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bench.h"
+
+/* ============================================================================
+ * CONFIGURATION
+ * ============================================================================ */
+
+// Benchmark sizes
+#define BENCH_BYTES     4096
+#define BENCH_SIEVE     8192
+#define BENCH_SLOTS     256
+#define BENCH_SEARCH    1024
+#define BENCH_KEYS      256
+
+#define CRC32_POLY      0xEDB88320U     // IEEE 802.3 (reflected)
+
+// Keep the kernels out of line so 'rv run -F' can time them
+#define NOINLINE __attribute__((noinline))
+
+#define WORD_BITS       (8 * sizeof(unsigned long))
+
+/* ============================================================================
+ * Zbs (Single-Bit) Tests
+ * ============================================================================ */
+
+/**
+ * Set a pin in a GPIO mask (blink.c's LED_MASK with a variable pin)
+ * Compiles to: bset a0, a0, a1 (Zbs), or li/sll/or without it
+ */
+uint32_t test_bset(uint32_t reg, unsigned int pin) {
+    return reg | (1U << pin);
+}
+
+/**
+ * Clear a pin
+ * Compiles to: bclr a0, a0, a1
+ */
+uint32_t test_bclr(uint32_t reg, unsigned int pin) {
+    return reg & ~(1U << pin);
+}
+
+/**
+ * Toggle a pin
+ * Compiles to: binv a0, a0, a1
+ */
+uint32_t test_binv(uint32_t reg, unsigned int pin) {
+    return reg ^ (1U << pin);
+}
+
+/**
+ * Read a pin
+ * Compiles to: bext a0, a0, a1
+ */
+uint32_t test_bext(uint32_t reg, unsigned int pin) {
+    return (reg >> pin) & 1;
+}
+
+/**
+ * Set a constant high bit (no lui for the mask)
+ * Compiles to: bseti a0, a0, 20
+ */
+uint32_t test_bseti(uint32_t reg) {
+    return reg | (1U << 20);
+}
+
+/* ============================================================================
+ * Bitmaps (XLEN-bit words: bset/bclr take the bit index modulo XLEN, so
+ * no andi on the index)
+ * ============================================================================ */
+
+static inline void bitmap_set(unsigned long *map, unsigned int bit) {
+    map[bit / WORD_BITS] |= 1UL << (bit % WORD_BITS);
+}
+
+static inline void bitmap_clear(unsigned long *map, unsigned int bit) {
+    map[bit / WORD_BITS] &= ~(1UL << (bit % WORD_BITS));
+}
+
+static inline int bitmap_test(const unsigned long *map, unsigned int bit) {
+    return (map[bit / WORD_BITS] >> (bit % WORD_BITS)) & 1;
+}
+
+/**
+ * Count the primes below n (n <= BENCH_SIEVE)
+ * Bit i of the map marks odd i as composite.
+ */
+static unsigned long sieve_bits[BENCH_SIEVE / WORD_BITS];
+
+NOINLINE uint32_t sieve_count(uint32_t n) {
+    uint32_t count = n > 2;
+
+    for (size_t i = 0; i < BENCH_SIEVE / WORD_BITS; i++) {
+        sieve_bits[i] = 0;
+    }
+    for (uint32_t i = 3; i < n; i += 2) {
+        if (bitmap_test(sieve_bits, i)) {
+            continue;
+        }
+        count++;
+        for (uint32_t j = i * i; j < n; j += 2 * i) {
+            bitmap_set(sieve_bits, j);
+        }
+    }
+    return count;
+}
+
+/**
+ * Slot allocator: first free slot (ctz of the inverted word, Zbb) claimed
+ * with bset. Returns -1 when all count slots are taken.
+ */
+NOINLINE int slot_alloc(unsigned long *map, unsigned int count) {
+    for (unsigned int w = 0; w < (count + WORD_BITS - 1) / WORD_BITS; w++) {
+        unsigned long free_bits = ~map[w];
+        if (free_bits) {
+            unsigned int bit = w * WORD_BITS + (unsigned int)__builtin_ctzl(free_bits);
+            if (bit >= count) {
+                break;
+            }
+            bitmap_set(map, bit);
+            return (int)bit;
+        }
+    }
+    return -1;
+}
+
+void slot_free(unsigned long *map, unsigned int slot) {
+    bitmap_clear(map, slot);
+}
+
+/* ============================================================================
+ * Zbc (Carry-Less Multiply): CRC32
+ * ============================================================================
+ *
+ * With Zbc, each XLEN-bit word w is folded into the CRC with a Barrett
+ * reduction: for s = crc ^ w, the quotient of s * x^32 by the polynomial P
+ * is estimated with one clmul by QT = floor(x^(XLEN+32) / P), and clmulr by
+ * P leaves the remainder, which is the new CRC. Two multiplies per word and
+ * no table. Without Zbc, the byte table (1 KB, built in crc32_init) is the
+ * baseline.
+ */
+
+#if defined(__riscv_zbc)
+
+#if __riscv_xlen == 64
+#define CRC32_QT        0x5A72D812FB808B20UL    // floor(x^96 / P), reflected, x^64 dropped
+#else
+#define CRC32_QT        0xFB808B20UL            // floor(x^64 / P), reflected, x^32 dropped
+#endif
+
+/**
+ * Carry-less multiply, low XLEN bits of the product
+ * Compiles to: clmul a0, a0, a1
+ */
+static inline unsigned long clmul(unsigned long a, unsigned long b) {
+    unsigned long r;
+    __asm__ ("clmul %0, %1, %2" : "=r"(r) : "r"(a), "r"(b));
+    return r;
+}
+
+/**
+ * Carry-less multiply, product bits 2*XLEN-2..XLEN-1 (bit-reflected high half)
+ * Compiles to: clmulr a0, a0, a1
+ */
+static inline unsigned long clmulr(unsigned long a, unsigned long b) {
+    unsigned long r;
+    __asm__ ("clmulr %0, %1, %2" : "=r"(r) : "r"(a), "r"(b));
+    return r;
+}
+
+/**
+ * CRC of s, the running CRC XORed with the next XLEN bits of input
+ */
+static inline uint32_t crc32_fold(unsigned long s) {
+    unsigned long t = (clmul(s, CRC32_QT) << 1) ^ s;
+#if __riscv_xlen == 64
+    return (uint32_t)(clmulr(t, (unsigned long)CRC32_POLY << 32) >> 32);
+#else
+    return (uint32_t)clmulr(t, CRC32_POLY);
+#endif
+}
+
+static void crc32_init(void) {
+}
+
+// Head and tail bytes (at most XLEN/8 - 1 each): bitwise
+static inline uint32_t crc32_byte(uint32_t crc, uint8_t byte) {
+    crc ^= byte;
+    for (int k = 0; k < 8; k++) {
+        crc = (crc >> 1) ^ (CRC32_POLY & -(crc & 1));
+    }
+    return crc;
+}
+
+#else
+
+static uint32_t crc32_table[256];
+
+static void crc32_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c >> 1) ^ (CRC32_POLY & -(c & 1));
+        }
+        crc32_table[i] = c;
+    }
+}
+
+static inline uint32_t crc32_byte(uint32_t crc, uint8_t byte) {
+    return (crc >> 8) ^ crc32_table[(crc ^ byte) & 0xFF];
+}
+
+#endif /* __riscv_zbc */
+
+/**
+ * Update a CRC32 with len bytes
+ * Start with crc = 0 and chain calls; the pre/post inversion is internal.
+ */
+NOINLINE uint32_t crc32_update(uint32_t crc, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    crc = ~crc;
+
+#if defined(__riscv_zbc)
+    // Byte steps until p is word aligned, then one fold per word
+    while (len && ((uintptr_t)p & (sizeof(unsigned long) - 1))) {
+        crc = crc32_byte(crc, *p++);
+        len--;
+    }
+    while (len >= sizeof(unsigned long)) {
+        unsigned long word;
+        __builtin_memcpy(&word, __builtin_assume_aligned(p, sizeof(unsigned long)), sizeof(word));
+        crc = crc32_fold(crc ^ word);
+        p += sizeof(unsigned long);
+        len -= sizeof(unsigned long);
+    }
+#endif
+
+    while (len--) {
+        crc = crc32_byte(crc, *p++);
+    }
+    return ~crc;
+}
+
+/* ============================================================================
+ * Zicond (Conditional Zero) Tests
+ * ============================================================================ */
+
+/**
+ * Value or zero
+ * Compiles to: czero.eqz a0, a0, a1
+ */
+uint32_t test_czero_eqz(uint32_t val, uint32_t cond) {
+    return cond ? val : 0;
+}
+
+/**
+ * Zero or value
+ * Compiles to: czero.nez a0, a0, a1
+ */
+uint32_t test_czero_nez(uint32_t val, uint32_t cond) {
+    return cond ? 0 : val;
+}
+
+/**
+ * Two-way select with no branch
+ * Compiles to: czero.eqz + czero.nez + or
+ */
+int32_t test_select(int cond, int32_t a, int32_t b) {
+    return cond ? a : b;
+}
+
+/**
+ * Minimum of two ints (zba_zbb_test.c's test_min)
+ * Compiles to: min (Zbb); slt + czero.eqz/czero.nez + or with Zicond only
+ */
+int32_t test_min_select(int32_t a, int32_t b) {
+    return (a < b) ? a : b;
+}
+
+/**
+ * Index of the first element >= key in sorted a[0..n-1] (n >= 1)
+ * The halving step is a select, not a branch, so the loop runs the same
+ * log2(n) iterations for every key and never mispredicts.
+ */
+NOINLINE size_t lower_bound(const int32_t *a, size_t n, int32_t key) {
+    const int32_t *base = a;
+
+    while (n > 1) {
+        size_t half = n / 2;
+        base += (base[half] < key) ? half : 0;      // czero.eqz
+        n -= half;
+    }
+    return (size_t)(base - a) + (*base < key);
+}
+
+/**
+ * out[i] = x[i] where it exceeds the threshold, else fallback[i]
+ */
+NOINLINE void blend(int32_t *restrict out, const int32_t *restrict x,
+                    const int32_t *restrict fallback, size_t n, int32_t threshold) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = (x[i] > threshold) ? x[i] : fallback[i];
+    }
+}
+
+/* ============================================================================
+ * Benchmark
+ * ============================================================================ */
+
+enum { K_CRC32, K_SIEVE, K_ALLOC, K_SEARCH, K_BLEND, KERNEL_COUNT };
+
+/**
+ * Cycles per kernel: bitops_bench[kernel]
+ */
+volatile uint32_t bitops_bench[KERNEL_COUNT];
+volatile uint32_t bitops_errors;
+
+static uint8_t bench_buf[BENCH_BYTES] __attribute__((aligned(8)));
+static unsigned long bench_slots[(BENCH_SLOTS + WORD_BITS - 1) / WORD_BITS];
+static int32_t bench_sorted[BENCH_SEARCH];
+static int32_t bench_keys[BENCH_KEYS];
+static int32_t bench_x[BENCH_KEYS];
+static int32_t bench_out[BENCH_KEYS];
+
+static void bench_init(void) {
+    for (size_t i = 0; i < BENCH_BYTES; i++) {
+        bench_buf[i] = (uint8_t)rng_next();
+    }
+    // Sorted, with runs of equal values
+    for (size_t i = 0; i < BENCH_SEARCH; i++) {
+        bench_sorted[i] = (int32_t)(i / 2) * 3;
+    }
+    for (size_t i = 0; i < BENCH_KEYS; i++) {
+        bench_keys[i] = (int32_t)(rng_next() % (BENCH_SEARCH * 2));
+        bench_x[i] = (int32_t)(rng_next() % 2000) - 1000;
+    }
+}
+
+// Bitwise CRC32, the reference for both builds
+static uint32_t crc32_reference(const uint8_t *p, size_t len) {
+    uint32_t crc = 0xFFFFFFFFU;
+    while (len--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (CRC32_POLY & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static void bench_run(void) {
+    unsigned long start;
+    uint32_t crc;
+    size_t index;
+
+    bench_init();
+
+    // CRC32 (unaligned start and length exercise the head and tail bytes)
+    start = read_mcycle();
+    crc = crc32_update(0, bench_buf, BENCH_BYTES);
+    bitops_bench[K_CRC32] = (uint32_t)(read_mcycle() - start);
+    if (crc != crc32_reference(bench_buf, BENCH_BYTES)) bitops_errors++;
+    if (crc32_update(0, bench_buf + 3, BENCH_BYTES - 10) !=
+        crc32_reference(bench_buf + 3, BENCH_BYTES - 10)) bitops_errors++;
+
+    // Sieve: 1028 primes below 8192
+    start = read_mcycle();
+    if (sieve_count(BENCH_SIEVE) != 1028) bitops_errors++;
+    bitops_bench[K_SIEVE] = (uint32_t)(read_mcycle() - start);
+
+    // Allocate every slot, free the odd ones, allocate them again
+    start = read_mcycle();
+    for (int i = 0; i < BENCH_SLOTS; i++) {
+        if (slot_alloc(bench_slots, BENCH_SLOTS) != i) bitops_errors++;
+    }
+    if (slot_alloc(bench_slots, BENCH_SLOTS) != -1) bitops_errors++;
+    for (unsigned int i = 1; i < BENCH_SLOTS; i += 2) {
+        slot_free(bench_slots, i);
+    }
+    for (int i = 1; i < BENCH_SLOTS; i += 2) {
+        if (slot_alloc(bench_slots, BENCH_SLOTS) != i) bitops_errors++;
+    }
+    bitops_bench[K_ALLOC] = (uint32_t)(read_mcycle() - start);
+
+    // Branchless binary search, checked against a linear scan
+    start = read_mcycle();
+    for (size_t i = 0; i < BENCH_KEYS; i++) {
+        bench_out[i] = (int32_t)lower_bound(bench_sorted, BENCH_SEARCH, bench_keys[i]);
+    }
+    bitops_bench[K_SEARCH] = (uint32_t)(read_mcycle() - start);
+    for (size_t i = 0; i < BENCH_KEYS; i++) {
+        for (index = 0; index < BENCH_SEARCH && bench_sorted[index] < bench_keys[i]; index++) {
+        }
+        if ((size_t)bench_out[i] != index) {
+            bitops_errors++;
+            break;
+        }
+    }
+
+    // Blend around a threshold
+    start = read_mcycle();
+    blend(bench_out, bench_x, bench_keys, BENCH_KEYS, 0);
+    bitops_bench[K_BLEND] = (uint32_t)(read_mcycle() - start);
+    for (size_t i = 0; i < BENCH_KEYS; i++) {
+        if (bench_out[i] != (bench_x[i] > 0 ? bench_x[i] : bench_keys[i])) {
+            bitops_errors++;
+            break;
+        }
+    }
+}
+
+/* ============================================================================
+ * Main - Exercise all functions
+ * ============================================================================ */
+
+int main(void) {
+    static const char check[] = "123456789";
+    volatile int result = 0;
+
+    crc32_init();
+    if (crc32_update(0, check, 9) != 0xCBF43926U) bitops_errors++;
+
+    // Zbs tests
+    result += test_bset(0x10, 3);
+    result += test_bclr(0x18, 3);
+    result += test_binv(0x10, 4);
+    result += test_bext(0x10, 4);
+    result += test_bseti(0);
+
+    // Zicond tests
+    result += test_czero_eqz(7, 1);
+    result += test_czero_nez(7, 1);
+    result += test_select(0, 10, 20);
+    result += test_min_select(10, 20);
+
+    bench_run();
+
+    return bitops_errors;
+}
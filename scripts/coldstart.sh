@@ -0,0 +1,55 @@
+#!/bin/bash
+#
+# Measure container cold-start time of the riscv-toolchain image.
+#
+# Times complete 'docker run --rm' invocations of 'rv version' and of a
+# trivial 'rv build' (an empty main, bare-metal), which is what a CI job
+# that starts one container per step pays. The first run of each command
+# is reported separately: right after 'docker build' or 'docker pull' it
+# includes faulting the image in from disk.
+#
+# Usage:
+#   scripts/coldstart.sh [image] [runs]
+#   scripts/coldstart.sh riscv-toolchain:old 20 && scripts/coldstart.sh riscv-toolchain 20
+#
+# For a truly cold first run, drop the page cache first (Linux, as root):
+#   sync && echo 3 > /proc/sys/vm/drop_caches
+#
+
+set -euo pipefail
+
+IMAGE="${1:-riscv-toolchain}"
+RUNS="${2:-10}"
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+echo 'int main(void) { return 0; }' > "$WORK/empty.c"
+
+now_ms() {
+    date +%s%3N
+}
+
+# time_runs <label> <command...>: run the container RUNS times and report
+# first/min/median/max wall time in milliseconds
+time_runs() {
+    local label="$1"
+    shift
+    local times=()
+    for ((i = 0; i < RUNS; i++)); do
+        local start end
+        start=$(now_ms)
+        docker run --rm -v "$WORK:/src" "$IMAGE" "$@" > /dev/null
+        end=$(now_ms)
+        times+=($((end - start)))
+    done
+    local first="${times[0]}"
+    local sorted
+    sorted=($(printf '%s\n' "${times[@]}" | sort -n))
+    printf "%-12s first %6d ms   min %6d ms   median %6d ms   max %6d ms\n" \
+        "$label" "$first" "${sorted[0]}" "${sorted[$((RUNS / 2))]}" "${sorted[$((RUNS - 1))]}"
+}
+
+echo "Image: $IMAGE ($(docker image inspect -f '{{.Size}}' "$IMAGE" | awk '{printf "%.1f MB", $1 / 1e6}'))"
+echo "Runs:  $RUNS"
+time_runs "rv version" rv version
+time_runs "rv build" rv build empty.c --arch 32imac --bare
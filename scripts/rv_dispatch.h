@@ -0,0 +1,65 @@
+/*
+ * Runtime ISA Dispatch for Multiversioned Kernels
+ *
+ * 'rv build --multiversion kernels.c:ARCH1,ARCH2' compiles kernels.c once
+ * per listed architecture plus once for --arch, renames each copy's
+ * functions apart (popcount -> popcount.32imac_zba_zbb) and links a
+ * generated dispatch unit. Every function of kernels.c then becomes a
+ * 3-instruction trampoline through __rv_dispatch_table, which starts out
+ * pointing at the --arch copies.
+ *
+ * crt0 calls __rv_dispatch_resolve() before main(). For each multiversioned
+ * file it takes the first listed variant the core can run:
+ *   - every single-letter extension of the variant is set in misa
+ *   - every Z extension of the variant is set in rv_board_zext()
+ * and falls back to the --arch build otherwise (also when misa reads 0).
+ * If the chosen variant uses F/D or V, mstatus.FS / mstatus.VS is turned on.
+ *
+ * misa has no bits for Z extensions, so the board says which it has:
+ *
+ *   uint32_t rv_board_zext(void) { return RV_ZEXT_ZBA | RV_ZEXT_ZBB; }
+ *
+ * The default (weak) one returns 0: no Z-extension variant is ever chosen.
+ * It runs before main(), after .data and .bss are set up, so it may read
+ * a strap, an OTP word or marchid/mimpid to tell boards apart.
+ *
+ * Usage:
+ *   rv build main.c --arch 32imac --bare \
+ *       --multiversion kernels.c:32imac_zba_zbb_zicond,32imac_zba_zbb
+ *   (include this header from main.c as "rv_dispatch.h")
+ */
+
+#ifndef RV_DISPATCH_H
+#define RV_DISPATCH_H
+
+#include <stdint.h>
+
+/* Z-extension bits of rv_board_zext() (same order as DISPATCH_ZEXT in rv) */
+#define RV_ZEXT_ZBA     (1u << 0)
+#define RV_ZEXT_ZBB     (1u << 1)
+#define RV_ZEXT_ZBC     (1u << 2)
+#define RV_ZEXT_ZBS     (1u << 3)
+#define RV_ZEXT_ZICOND  (1u << 4)
+#define RV_ZEXT_ZICBOZ  (1u << 5)
+#define RV_ZEXT_ZCA     (1u << 6)
+#define RV_ZEXT_ZCB     (1u << 7)
+#define RV_ZEXT_ZCMP    (1u << 8)
+#define RV_ZEXT_ZFH     (1u << 9)
+#define RV_ZEXT_ZVE32X  (1u << 10)
+#define RV_ZEXT_ZVE32F  (1u << 11)
+#define RV_ZEXT_ZVE64X  (1u << 12)
+#define RV_ZEXT_ZVE64D  (1u << 13)
+
+/* Z extensions this board implements (weak default: none) */
+uint32_t rv_board_zext(void);
+
+/* Pick a variant of every multiversioned file (crt0 calls it before main) */
+void __rv_dispatch_resolve(void);
+
+/*
+ * Architecture a multiversioned function runs as (e.g. "32imac_zba_zbb",
+ * or the --arch build), or 0 if the function is not multiversioned.
+ */
+const char *rv_dispatch_variant(const char *function);
+
+#endif /* RV_DISPATCH_H */
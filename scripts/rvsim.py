@@ -0,0 +1,2197 @@
+"""
+rvsim - RISC-V instruction set simulator for 'rv run' and 'rv tune'
+
+Runs bare-metal RV32/RV64 programs built by 'rv build --bare' with a simple
+in-order timing model: every instruction costs a fixed number of cycles by
+class (COSTS) and taken branches and jumps add a refill penalty. The
+cycle/mcycle CSRs read the modelled count, so benchmarks that time
+themselves with rdcycle see the same numbers 'rv run' reports. The numbers
+are for comparing builds against each other, not a specific core.
+
+Supported: RV32/RV64 I, M, A, F, D, C (and Zca/Zcb/Zcmp: cm.push/pop cost
+a store/load per register), Zicsr, Zifencei, Zba, Zbb, Zbs, Zbc
+(carry-less multiplies cost a "mul"), Zicond, Zicboz (cbo.zero clears a
+64-byte block, as crt0's memset assumes), and V / Zve32x / Zve32f /
+Zve64x / Zve64f / Zve64d at a configurable VLEN (32-bit
+and 64-bit floating-point elements; no fixed-point ops). Only the
+extensions in the program's -march are accepted; anything else stops the
+run as an illegal instruction.
+
+A vector instruction costs its class once plus a cycle for every further
+VLEN bits of elements it processes (one element per cycle for strided
+and indexed memory accesses), as on a core with a VLEN-wide datapath.
+
+Memory is a few flat regions covering the program's load segments (ROM,
+RAM with the stack). Outside them, a 16550 UART transmit register at
+0x10000000 prints, and every other address behaves like a plain device
+register.
+
+A run stops at a jump-to-self (crt0's 'j .' after main returns, so a0 is
+main's return value), an exit ecall (a7 = 93), ebreak, a fault or the
+instruction limit.
+"""
+
+import math
+import struct
+
+# Cycles per instruction class. "taken" is added on top for taken
+# branches and jumps (pipeline refill).
+COSTS = {
+    "alu": 1,
+    "branch": 1,
+    "jump": 1,
+    "taken": 2,
+    "load": 2,
+    "store": 1,
+    "mul": 3,
+    "div": 34,
+    "amo": 4,
+    "csr": 1,
+    "system": 1,
+    "fence": 1,
+    "cbo": 2,
+    "fpu": 4,
+    "fma": 5,
+    "fdiv": 20,
+    "fsqrt": 25,
+    "fmisc": 2,
+    "vset": 1,
+    "valu": 1,
+    "vmul": 3,
+    "vdiv": 34,
+    "vfpu": 4,
+    "vfdiv": 20,
+    "vload": 2,
+    "vstore": 1,
+}
+
+# Classes whose handlers read or add to the cycle count themselves
+SYNC_CLASSES = {"csr", "system", "valu", "vmul", "vdiv", "vfpu", "vfdiv", "vload", "vstore"}
+
+UART_BASE = 0x10000000
+
+U8 = struct.Struct("<B")
+U16 = struct.Struct("<H")
+U32 = struct.Struct("<I")
+U64 = struct.Struct("<Q")
+F32 = struct.Struct("<f")
+F64 = struct.Struct("<d")
+
+CSR_NAMES = {
+    0x001: "fflags", 0x002: "frm", 0x003: "fcsr",
+    0x008: "vstart", 0x009: "vxsat", 0x00A: "vxrm", 0x00F: "vcsr",
+    0x300: "mstatus", 0x301: "misa", 0x304: "mie", 0x305: "mtvec",
+    0x340: "mscratch", 0x341: "mepc", 0x342: "mcause", 0x343: "mtval", 0x344: "mip",
+    0xB00: "mcycle", 0xB02: "minstret", 0xB80: "mcycleh", 0xB82: "minstreth",
+    0xC00: "cycle", 0xC01: "time", 0xC02: "instret",
+    0xC80: "cycleh", 0xC81: "timeh", 0xC82: "instreth",
+    0xC20: "vl", 0xC21: "vtype", 0xC22: "vlenb",
+    0xF11: "mvendorid", 0xF12: "marchid", 0xF13: "mimpid", 0xF14: "mhartid",
+}
+
+
+class Halt(Exception):
+    """The program stopped (exit, ebreak, illegal instruction, fault)."""
+
+    def __init__(self, reason: str, message: str = "", code: int = None):
+        super().__init__(message or reason)
+        self.reason = reason
+        self.code = code
+
+
+def parse_march(march: str) -> tuple[int, set]:
+    """'rv32imac_zba_zbb' -> (32, {'i', 'm', 'a', 'c', 'zba', 'zbb'})."""
+    march = march.lower()
+    if not march.startswith(("rv32", "rv64")):
+        raise ValueError(f"unsupported -march '{march}'")
+    xlen = int(march[2:4])
+    base, *multi = march[4:].split("_")
+    extensions = set()
+    for i, letter in enumerate(base):
+        if letter == "g":
+            extensions |= {"i", "m", "a", "f", "d", "zicsr", "zifencei"}
+        elif letter == "z":
+            # Multi-letter extension without a separating underscore
+            multi.insert(0, base[i:])
+            break
+        else:
+            extensions.add(letter)
+    extensions |= {ext for ext in multi if ext}
+    # Spellings newer toolchains record in .riscv.attributes
+    if extensions & {"zcb", "zcmp", "zcf", "zcd"}:
+        extensions.add("zca")
+    if "zca" in extensions:
+        extensions.add("c")
+    if "b" in extensions:
+        extensions |= {"zba", "zbb", "zbs"}
+    if {"zaamo", "zalrsc"} <= extensions:
+        extensions.add("a")
+    if "d" in extensions:
+        extensions.add("f")
+    # V is the application profile of the vector extension, Zve* the
+    # embedded subsets (each implies the smaller ones)
+    if "v" in extensions:
+        extensions |= {"zve64d", "zvl128b"}
+    if "zve64d" in extensions:
+        extensions.add("zve64f")
+    if "zve64f" in extensions:
+        extensions |= {"zve64x", "zve32f"}
+    if extensions & {"zve64x", "zve32f"}:
+        extensions.add("zve32x")
+    return xlen, extensions
+
+
+def f32(value: float) -> float:
+    """Round a Python float to single precision."""
+    try:
+        return F32.unpack(F32.pack(value))[0]
+    except OverflowError:
+        return math.copysign(math.inf, value)
+
+
+def sext(value: int, bits: int) -> int:
+    """Sign-extend the low 'bits' bits of value."""
+    value &= (1 << bits) - 1
+    return value - (1 << bits) if value >> (bits - 1) else value
+
+
+# ----------------------------------------------------------------------------
+# Compressed instructions (expanded to their 32-bit equivalents)
+# ----------------------------------------------------------------------------
+
+def enc_r(op, rd, f3, rs1, rs2, f7):
+    return f7 << 25 | rs2 << 20 | rs1 << 15 | f3 << 12 | rd << 7 | op
+
+
+def enc_i(op, rd, f3, rs1, imm):
+    return (imm & 0xFFF) << 20 | rs1 << 15 | f3 << 12 | rd << 7 | op
+
+
+def enc_s(op, f3, rs1, rs2, imm):
+    return ((imm >> 5) & 0x7F) << 25 | rs2 << 20 | rs1 << 15 | f3 << 12 | (imm & 0x1F) << 7 | op
+
+
+def enc_b(f3, rs1, rs2, imm):
+    return (((imm >> 12) & 1) << 31 | ((imm >> 5) & 0x3F) << 25 | rs2 << 20 | rs1 << 15 | f3 << 12
+            | ((imm >> 1) & 0xF) << 8 | ((imm >> 11) & 1) << 7 | 0x63)
+
+
+def enc_j(rd, imm):
+    return (((imm >> 20) & 1) << 31 | ((imm >> 1) & 0x3FF) << 21 | ((imm >> 11) & 1) << 20
+            | ((imm >> 12) & 0xFF) << 12 | rd << 7 | 0x6F)
+
+
+def bits(value, hi, lo):
+    return (value >> lo) & ((1 << (hi - lo + 1)) - 1)
+
+
+def expand_compressed(h: int, xlen: int, extensions: set) -> int | None:
+    """32-bit equivalent of a 16-bit instruction, or None if it is not valid here."""
+    quadrant = h & 3
+    f3 = h >> 13
+    rd_ = 8 + bits(h, 4, 2)         # rd' / rs2'
+    rs1_ = 8 + bits(h, 9, 7)        # rs1' / rd'
+    rd = bits(h, 11, 7)
+    rs2 = bits(h, 6, 2)
+    imm6 = sext(bits(h, 12, 12) << 5 | bits(h, 6, 2), 6)
+    # Offsets of the register-based loads and stores
+    uimm_w = bits(h, 12, 10) << 3 | bits(h, 6, 6) << 2 | bits(h, 5, 5) << 6
+    uimm_d = bits(h, 12, 10) << 3 | bits(h, 6, 5) << 6
+
+    if quadrant == 0:
+        if f3 == 0:
+            imm = bits(h, 12, 11) << 4 | bits(h, 10, 7) << 6 | bits(h, 6, 6) << 2 | bits(h, 5, 5) << 3
+            return enc_i(0x13, rd_, 0, 2, imm) if imm else None                 # c.addi4spn
+        if f3 == 1 and "d" in extensions:
+            return enc_i(0x07, rd_, 3, rs1_, uimm_d)                            # c.fld
+        if f3 == 2:
+            return enc_i(0x03, rd_, 2, rs1_, uimm_w)                            # c.lw
+        if f3 == 3:
+            if xlen == 64:
+                return enc_i(0x03, rd_, 3, rs1_, uimm_d)                        # c.ld
+            if "f" in extensions:
+                return enc_i(0x07, rd_, 2, rs1_, uimm_w)                        # c.flw
+        if f3 == 4 and "zcb" in extensions:
+            uimm_b = bits(h, 5, 5) << 1 | bits(h, 6, 6)
+            uimm_h = bits(h, 5, 5) << 1
+            funct = bits(h, 12, 10)
+            if funct == 0:
+                return enc_i(0x03, rd_, 4, rs1_, uimm_b)                        # c.lbu
+            if funct == 1:
+                return enc_i(0x03, rd_, 1 if bits(h, 6, 6) else 5, rs1_, uimm_h)   # c.lh / c.lhu
+            if funct == 2:
+                return enc_s(0x23, 0, rs1_, rd_, uimm_b)                        # c.sb
+            if funct == 3 and not bits(h, 6, 6):
+                return enc_s(0x23, 1, rs1_, rd_, uimm_h)                        # c.sh
+            return None
+        if f3 == 5 and "d" in extensions:
+            return enc_s(0x27, 3, rs1_, rd_, uimm_d)                            # c.fsd
+        if f3 == 6:
+            return enc_s(0x23, 2, rs1_, rd_, uimm_w)                            # c.sw
+        if f3 == 7:
+            if xlen == 64:
+                return enc_s(0x23, 3, rs1_, rd_, uimm_d)                        # c.sd
+            if "f" in extensions:
+                return enc_s(0x27, 2, rs1_, rd_, uimm_w)                        # c.fsw
+        return None
+
+    if quadrant == 1:
+        jimm = sext(bits(h, 12, 12) << 11 | bits(h, 11, 11) << 4 | bits(h, 10, 9) << 8
+                    | bits(h, 8, 8) << 10 | bits(h, 7, 7) << 6 | bits(h, 6, 6) << 7
+                    | bits(h, 5, 3) << 1 | bits(h, 2, 2) << 5, 12)
+        bimm = sext(bits(h, 12, 12) << 8 | bits(h, 11, 10) << 3 | bits(h, 6, 5) << 6
+                    | bits(h, 4, 3) << 1 | bits(h, 2, 2) << 5, 9)
+        if f3 == 0:
+            return enc_i(0x13, rd, 0, rd, imm6)                                 # c.addi / c.nop
+        if f3 == 1:
+            if xlen == 32:
+                return enc_j(1, jimm)                                           # c.jal
+            return enc_i(0x1B, rd, 0, rd, imm6) if rd else None                 # c.addiw
+        if f3 == 2:
+            return enc_i(0x13, rd, 0, 0, imm6)                                  # c.li
+        if f3 == 3:
+            if rd == 2:
+                imm = sext(bits(h, 12, 12) << 9 | bits(h, 6, 6) << 4 | bits(h, 5, 5) << 6
+                           | bits(h, 4, 3) << 7 | bits(h, 2, 2) << 5, 10)
+                return enc_i(0x13, 2, 0, 2, imm) if imm else None               # c.addi16sp
+            if imm6 == 0:
+                return None
+            return (imm6 & 0xFFFFF) << 12 | rd << 7 | 0x37                      # c.lui
+        if f3 == 4:
+            op2 = bits(h, 11, 10)
+            shamt = bits(h, 12, 12) << 5 | bits(h, 6, 2)
+            if op2 == 0:
+                return enc_i(0x13, rs1_, 5, rs1_, shamt)                        # c.srli
+            if op2 == 1:
+                return enc_i(0x13, rs1_, 5, rs1_, shamt | 0x400)                # c.srai
+            if op2 == 2:
+                return enc_i(0x13, rs1_, 7, rs1_, imm6)                         # c.andi
+            op = bits(h, 6, 5)
+            if not bits(h, 12, 12):
+                f3_, f7 = [(0, 0x20), (4, 0), (6, 0), (7, 0)][op]               # c.sub/xor/or/and
+                return enc_r(0x33, rs1_, f3_, rs1_, rd_, f7)
+            if xlen == 64 and op < 2:
+                return enc_r(0x3B, rs1_, 0, rs1_, rd_, 0x20 if op == 0 else 0)  # c.subw / c.addw
+            if "zcb" in extensions and op == 2 and extensions & {"m", "zmmul"}:
+                return enc_r(0x33, rs1_, 0, rs1_, rd_, 1)                       # c.mul
+            if "zcb" in extensions and op == 3:
+                unary = bits(h, 4, 2)
+                if unary == 0:
+                    return enc_i(0x13, rs1_, 7, rs1_, 0xFF)                     # c.zext.b
+                if unary == 5:
+                    return enc_i(0x13, rs1_, 4, rs1_, -1)                       # c.not
+                if "zbb" in extensions and unary in (1, 3):
+                    return enc_i(0x13, rs1_, 1, rs1_, 0x604 if unary == 1 else 0x605)  # c.sext.b/h
+                if "zbb" in extensions and unary == 2:
+                    return enc_r(0x33 if xlen == 32 else 0x3B, rs1_, 4, rs1_, 0, 0x04)  # c.zext.h
+                if "zba" in extensions and unary == 4 and xlen == 64:
+                    return enc_r(0x3B, rs1_, 0, rs1_, 0, 0x04)                  # c.zext.w
+            return None
+        if f3 == 5:
+            return enc_j(0, jimm)                                               # c.j
+        return enc_b(f3 - 6, rs1_, 0, bimm)                                     # c.beqz / c.bnez
+
+    if quadrant == 2:
+        if f3 == 0:
+            return enc_i(0x13, rd, 1, rd, bits(h, 12, 12) << 5 | bits(h, 6, 2))  # c.slli
+        uimm_dsp = bits(h, 12, 12) << 5 | bits(h, 6, 5) << 3 | bits(h, 4, 2) << 6
+        uimm_wsp = bits(h, 12, 12) << 5 | bits(h, 6, 4) << 2 | bits(h, 3, 2) << 6
+        sdsp = bits(h, 12, 10) << 3 | bits(h, 9, 7) << 6
+        swsp = bits(h, 12, 9) << 2 | bits(h, 8, 7) << 6
+        if f3 == 1 and "d" in extensions:
+            return enc_i(0x07, rd, 3, 2, uimm_dsp)                              # c.fldsp
+        if f3 == 2:
+            return enc_i(0x03, rd, 2, 2, uimm_wsp) if rd else None              # c.lwsp
+        if f3 == 3:
+            if xlen == 64:
+                return enc_i(0x03, rd, 3, 2, uimm_dsp) if rd else None          # c.ldsp
+            if "f" in extensions:
+                return enc_i(0x07, rd, 2, 2, uimm_wsp)                          # c.flwsp
+        if f3 == 4:
+            if not bits(h, 12, 12):
+                if rs2 == 0:
+                    return enc_i(0x67, 0, 0, rd, 0) if rd else None             # c.jr
+                return enc_r(0x33, rd, 0, 0, rs2, 0)                            # c.mv
+            if rs2 == 0:
+                if rd == 0:
+                    return 0x00100073                                           # c.ebreak
+                return enc_i(0x67, 1, 0, rd, 0)                                 # c.jalr
+            return enc_r(0x33, rd, 0, rd, rs2, 0)                               # c.add
+        if f3 == 5 and "d" in extensions:
+            return enc_s(0x27, 3, 2, rs2, sdsp)                                 # c.fsdsp
+        if f3 == 6:
+            return enc_s(0x23, 2, 2, rs2, swsp)                                 # c.swsp
+        if f3 == 7:
+            if xlen == 64:
+                return enc_s(0x23, 3, 2, rs2, sdsp)                             # c.sdsp
+            if "f" in extensions:
+                return enc_s(0x27, 2, 2, rs2, swsp)                             # c.fswsp
+    return None
+
+
+# ----------------------------------------------------------------------------
+# Machine
+# ----------------------------------------------------------------------------
+
+class Machine:
+    """
+    One hart with flat memory.
+
+    Instructions are decoded once into closures (cached by address) that
+    update the register file and return the next pc; run() drives them and
+    does the cycle accounting.
+    """
+
+    def __init__(self, march: str, regions: list[tuple[int, int]], costs: dict = None,
+                 output=None, vlen: int = 128, cbo_block: int = 64):
+        self.xlen, self.extensions = parse_march(march)
+        self.march = march
+        self.mask = (1 << self.xlen) - 1
+        self.costs = dict(COSTS, **(costs or {}))
+        # (base, memory) by descending address: the first region (RAM and
+        # the stack in the usual layouts) gets the fast path
+        self.regions = [(base, bytearray(size)) for base, size in sorted(regions, reverse=True)]
+        self.x = [0] * 32
+        self.f = [0.0] * 32
+        self.csr = {}
+        self.devices = {}
+        self.cache = {}
+        self.cycles = 0
+        self.instret = 0
+        self.reservation = None
+        self.output = output
+        self.uart = []
+        self.cbo_block = cbo_block
+        self.build_memory_access()
+        # Vector unit: 32 VLEN-bit registers, vtype invalid until a vsetvl
+        minimum = max([int(ext[3:-1]) for ext in self.extensions
+                       if ext.startswith("zvl") and ext.endswith("b") and ext[3:-1].isdigit()] + [32])
+        if vlen & (vlen - 1) or not minimum <= vlen <= 65536:
+            raise ValueError(f"VLEN must be a power of two from {minimum} to 65536 for {march}, not {vlen}")
+        self.vlen = vlen
+        self.vlenb = vlen // 8
+        self.elen = 64 if "zve64x" in self.extensions else 32
+        self.v = bytearray(32 * self.vlenb)
+        self.set_vtype(1 << (self.xlen - 1), 0)
+
+    def load(self, addr: int, data: bytes):
+        """Copy a load segment into memory."""
+        for base, mem in self.regions:
+            off = addr - base
+            if 0 <= off and off + len(data) <= len(mem):
+                mem[off:off + len(data)] = data
+                return
+        raise ValueError(f"segment 0x{addr:x}+{len(data)} is outside simulated memory")
+
+    # -- memory -------------------------------------------------------------
+
+    def build_memory_access(self):
+        """Create the load/store helpers the decoded instructions call."""
+        base, mem = self.regions[0]
+        size = len(mem)
+        mask = self.mask
+        device_load = self.device_load
+        device_store = self.device_store
+
+        def make_load(fmt, width, signed):
+            unpack = fmt.unpack_from
+            limit = size - width
+            top = 1 << (width * 8)
+            half = top >> 1
+
+            if signed:
+                def load(addr):
+                    off = addr - base
+                    if 0 <= off <= limit:
+                        value = unpack(mem, off)[0]
+                    else:
+                        value = device_load(addr, width)
+                    return (value - top if value >= half else value) & mask
+            else:
+                def load(addr):
+                    off = addr - base
+                    if 0 <= off <= limit:
+                        return unpack(mem, off)[0]
+                    return device_load(addr, width)
+            return load
+
+        def make_store(fmt, width):
+            pack = fmt.pack_into
+            limit = size - width
+            value_mask = (1 << (width * 8)) - 1
+
+            def store(addr, value):
+                off = addr - base
+                if 0 <= off <= limit:
+                    pack(mem, off, value & value_mask)
+                else:
+                    device_store(addr, width, value & value_mask)
+            return store
+
+        self.load8 = make_load(U8, 1, True)
+        self.load8u = make_load(U8, 1, False)
+        self.load16 = make_load(U16, 2, True)
+        self.load16u = make_load(U16, 2, False)
+        self.load32 = make_load(U32, 4, True)
+        self.load32u = make_load(U32, 4, False)
+        self.load64 = make_load(U64, 8, False)
+        self.store8 = make_store(U8, 1)
+        self.store16 = make_store(U16, 2)
+        self.store32 = make_store(U32, 4)
+        self.store64 = make_store(U64, 8)
+
+    def device_load(self, addr: int, width: int) -> int:
+        """Loads outside the first region: the other regions, then devices."""
+        for base, mem in self.regions[1:]:
+            off = addr - base
+            if 0 <= off <= len(mem) - width:
+                return int.from_bytes(mem[off:off + width], "little")
+        if UART_BASE <= addr < UART_BASE + 8:
+            return 0x60 if addr == UART_BASE + 5 else 0     # LSR: transmitter empty
+        if addr < 0x1000:
+            raise Halt("fault", f"load from 0x{addr:x}")
+        return self.devices.get(addr, 0)
+
+    def device_store(self, addr: int, width: int, value: int):
+        for base, mem in self.regions[1:]:
+            off = addr - base
+            if 0 <= off <= len(mem) - width:
+                mem[off:off + width] = value.to_bytes(width, "little")
+                return
+        if addr == UART_BASE:
+            self.uart.append(chr(value & 0xFF))
+            if value == 0x0A and self.output:
+                self.output("".join(self.uart))
+                self.uart.clear()
+            return
+        if addr < 0x1000:
+            raise Halt("fault", f"store to 0x{addr:x}")
+        self.devices[addr] = value
+
+    def flush_output(self) -> str:
+        text = "".join(self.uart)
+        self.uart.clear()
+        if text and self.output:
+            self.output(text)
+        return text
+
+    # -- CSRs ---------------------------------------------------------------
+
+    def misa(self) -> int:
+        value = (1 if self.xlen == 32 else 2) << (self.xlen - 2)
+        for letter in self.extensions:
+            if len(letter) == 1:
+                value |= 1 << (ord(letter) - ord("a"))
+        return value
+
+    def read_csr(self, number: int) -> int:
+        name = CSR_NAMES.get(number)
+        if name in ("mcycle", "cycle", "time"):
+            return self.cycles & self.mask
+        if name in ("minstret", "instret"):
+            return self.instret & self.mask
+        if name in ("mcycleh", "cycleh", "timeh"):
+            return (self.cycles >> 32) & 0xFFFFFFFF
+        if name in ("minstreth", "instreth"):
+            return (self.instret >> 32) & 0xFFFFFFFF
+        if name == "misa":
+            return self.misa()
+        if name in ("mhartid", "mvendorid", "marchid", "mimpid"):
+            return 0
+        if name == "fcsr":
+            return self.csr.get(0x002, 0) << 5 | self.csr.get(0x001, 0)
+        if name == "vl":
+            return self.vl
+        if name == "vtype":
+            return self.vtype
+        if name == "vlenb":
+            return self.vlenb
+        return self.csr.get(number, 0)
+
+    def write_csr(self, number: int, value: int):
+        name = CSR_NAMES.get(number)
+        if name == "mcycle":
+            self.cycles = value
+        elif name == "minstret":
+            self.instret = value
+        elif name == "fcsr":
+            self.csr[0x001] = value & 0x1F
+            self.csr[0x002] = (value >> 5) & 7
+        elif name in ("misa", "mhartid", "mvendorid", "marchid", "mimpid", "cycle", "time", "instret",
+                      "vl", "vtype", "vlenb"):
+            pass
+        else:
+            self.csr[number] = value & self.mask
+
+    # -- decoding -----------------------------------------------------------
+
+    def decode(self, pc: int) -> tuple:
+        """(handler, size, cost, sync) for the instruction at pc."""
+        try:
+            h = self.load16u(pc)
+        except Halt:
+            raise Halt("fault", f"instruction fetch from 0x{pc:x}")
+        if h & 3 != 3:
+            if "c" not in self.extensions:
+                raise Halt("illegal", f"illegal instruction 0x{h:04x} at 0x{pc:x} (C not enabled)")
+            if h & 3 == 2 and h >> 13 == 5 and "zcmp" in self.extensions:
+                # Zcmp takes over the C.FSDSP encodings
+                decoded = self.decode_zcmp(h)
+                if decoded is None:
+                    raise Halt("illegal", f"illegal instruction 0x{h:04x} at 0x{pc:x}")
+                fn, cost = decoded
+                return fn, 2, cost, False
+            inst = expand_compressed(h, self.xlen, self.extensions)
+            if inst is None:
+                raise Halt("illegal", f"illegal instruction 0x{h:04x} at 0x{pc:x}")
+            size = 2
+        else:
+            inst = self.load32u(pc)
+            size = 4
+        decoded = self.decode32(inst, size)
+        if decoded is None:
+            shown = f"0x{h:04x}" if size == 2 else f"0x{inst:08x}"
+            raise Halt("illegal", f"illegal instruction {shown} at 0x{pc:x}")
+        fn, kind = decoded
+        return fn, size, self.costs[kind], kind in SYNC_CLASSES
+
+    def decode32(self, inst: int, size: int):
+        """(handler, cost class) for a 32-bit instruction, or None if illegal."""
+        x = self.x
+        xlen = self.xlen
+        mask = self.mask
+        sign = 1 << (xlen - 1)
+        top = 1 << xlen
+        ext = self.extensions
+
+        op = inst & 0x7F
+        rd = (inst >> 7) & 0x1F
+        f3 = (inst >> 12) & 7
+        rs1 = (inst >> 15) & 0x1F
+        rs2 = (inst >> 20) & 0x1F
+        f7 = inst >> 25
+        imm_i = sext(inst >> 20, 12)
+        imm_s = sext((inst >> 25) << 5 | rd, 12)
+
+        def signed(value):
+            return value - top if value & sign else value
+
+        def nop(pc):
+            return pc + size
+
+        # Register-register and register-immediate ALU ops share this: 'compute'
+        # maps the operand values to the result
+        def alu_rr(compute):
+            if rd == 0:
+                return nop
+
+            def fn(pc):
+                x[rd] = compute(x[rs1], x[rs2]) & mask
+                return pc + size
+            return fn
+
+        def alu_ri(compute, imm):
+            if rd == 0:
+                return nop
+
+            def fn(pc):
+                x[rd] = compute(x[rs1], imm) & mask
+                return pc + size
+            return fn
+
+        def word(value):
+            """RV64 *W result: sign-extend the low 32 bits."""
+            value &= 0xFFFFFFFF
+            return value - 0x100000000 if value & 0x80000000 else value
+
+        if op == 0x37:                                  # lui
+            value = sext(inst & 0xFFFFF000, 32) & mask
+            if rd == 0:
+                return nop, "alu"
+
+            def lui(pc):
+                x[rd] = value
+                return pc + size
+            return lui, "alu"
+
+        if op == 0x17:                                  # auipc
+            offset = sext(inst & 0xFFFFF000, 32)
+            if rd == 0:
+                return nop, "alu"
+
+            def auipc(pc):
+                x[rd] = (pc + offset) & mask
+                return pc + size
+            return auipc, "alu"
+
+        if op == 0x6F:                                  # jal
+            offset = sext(bits(inst, 31, 31) << 20 | bits(inst, 19, 12) << 12
+                          | bits(inst, 20, 20) << 11 | bits(inst, 30, 21) << 1, 21)
+
+            def jal(pc):
+                if rd:
+                    x[rd] = (pc + size) & mask
+                return (pc + offset) & mask
+            return jal, "jump"
+
+        if op == 0x67 and f3 == 0:                      # jalr
+            def jalr(pc):
+                target = (x[rs1] + imm_i) & mask & ~1
+                if rd:
+                    x[rd] = (pc + size) & mask
+                return target
+            return jalr, "jump"
+
+        if op == 0x63:                                  # branches
+            offset = sext(bits(inst, 31, 31) << 12 | bits(inst, 7, 7) << 11
+                          | bits(inst, 30, 25) << 5 | bits(inst, 11, 8) << 1, 13)
+            conditions = {
+                0: lambda a, b: a == b,
+                1: lambda a, b: a != b,
+                4: lambda a, b: signed(a) < signed(b),
+                5: lambda a, b: signed(a) >= signed(b),
+                6: lambda a, b: a < b,
+                7: lambda a, b: a >= b,
+            }
+            if f3 not in conditions:
+                return None
+            taken = conditions[f3]
+
+            def branch(pc):
+                if taken(x[rs1], x[rs2]):
+                    return (pc + offset) & mask
+                return pc + size
+            return branch, "branch"
+
+        if op == 0x03:                                  # loads
+            loads = {0: self.load8, 1: self.load16, 2: self.load32 if xlen == 64 else self.load32u,
+                     4: self.load8u, 5: self.load16u}
+            if xlen == 64:
+                loads.update({3: self.load64, 6: self.load32u})
+            if f3 not in loads:
+                return None
+            load = loads[f3]
+
+            def load_op(pc):
+                value = load((x[rs1] + imm_i) & mask)
+                if rd:
+                    x[rd] = value
+                return pc + size
+            return load_op, "load"
+
+        if op == 0x23:                                  # stores
+            stores = {0: self.store8, 1: self.store16, 2: self.store32}
+            if xlen == 64:
+                stores[3] = self.store64
+            if f3 not in stores:
+                return None
+            store = stores[f3]
+
+            def store_op(pc):
+                store((x[rs1] + imm_s) & mask, x[rs2])
+                return pc + size
+            return store_op, "store"
+
+        if op == 0x13:                                  # OP-IMM
+            shamt = (inst >> 20) & (xlen - 1)
+            funct6 = inst >> 26
+            funct12 = inst >> 20
+            if f3 == 0:
+                return alu_ri(lambda a, b: a + b, imm_i), "alu"
+            if f3 == 2:
+                return alu_ri(lambda a, b: int(signed(a) < b), imm_i), "alu"
+            if f3 == 3:
+                return alu_ri(lambda a, b: int(a < b), imm_i & mask), "alu"
+            if f3 == 4:
+                return alu_ri(lambda a, b: a ^ b, imm_i & mask), "alu"
+            if f3 == 6:
+                return alu_ri(lambda a, b: a | b, imm_i & mask), "alu"
+            if f3 == 7:
+                return alu_ri(lambda a, b: a & b, imm_i & mask), "alu"
+            if f3 == 1:
+                if funct6 == 0 and (xlen == 64 or not inst >> 25 & 1):
+                    return alu_ri(lambda a, b: a << b, shamt), "alu"
+                if "zbb" in ext:
+                    unary = self.zbb_unary(funct12, xlen)
+                    if unary:
+                        return alu_ri(lambda a, b: unary(a), 0), "alu"
+                if "zbs" in ext and (xlen == 64 or not inst >> 25 & 1):
+                    compute = self.zbs_binary(funct6 << 1, f3)
+                    if compute:
+                        return alu_ri(compute, shamt), "alu"
+                return None
+            if f3 == 5:
+                if funct6 == 0 and (xlen == 64 or not inst >> 25 & 1):
+                    return alu_ri(lambda a, b: a >> b, shamt), "alu"
+                if funct6 == 0x10 and (xlen == 64 or not inst >> 25 & 1):
+                    return alu_ri(lambda a, b: signed(a) >> b, shamt), "alu"
+                if "zbb" in ext:
+                    if funct6 == 0x18:
+                        return alu_ri(lambda a, b: (a >> b | a << (xlen - b)) if b else a, shamt), "alu"
+                    if funct12 == 0x287:                # orc.b
+                        return alu_ri(lambda a, b: sum(0xFF << i for i in range(0, xlen, 8)
+                                                       if (a >> i) & 0xFF), 0), "alu"
+                    if funct12 == (0x698 if xlen == 32 else 0x6B8):     # rev8
+                        return alu_ri(lambda a, b: int.from_bytes(a.to_bytes(xlen // 8, "little"),
+                                                                  "big"), 0), "alu"
+                if "zbs" in ext and funct6 == 0x12 and (xlen == 64 or not inst >> 25 & 1):    # bexti
+                    return alu_ri(lambda a, b: a >> b & 1, shamt), "alu"
+                return None
+
+        if op == 0x33:                                  # OP
+            if f7 == 0x00:
+                table = {
+                    0: lambda a, b: a + b,
+                    1: lambda a, b: a << (b & (xlen - 1)),
+                    2: lambda a, b: int(signed(a) < signed(b)),
+                    3: lambda a, b: int(a < b),
+                    4: lambda a, b: a ^ b,
+                    5: lambda a, b: a >> (b & (xlen - 1)),
+                    6: lambda a, b: a | b,
+                    7: lambda a, b: a & b,
+                }
+                return alu_rr(table[f3]), "alu"
+            if f7 == 0x20 and f3 in (0, 5):
+                if f3 == 0:
+                    return alu_rr(lambda a, b: a - b), "alu"
+                return alu_rr(lambda a, b: signed(a) >> (b & (xlen - 1))), "alu"
+            if f7 == 0x01 and ("m" in ext or ("zmmul" in ext and f3 < 4)):
+                return self.muldiv(f3, xlen, signed, alu_rr)
+            if "zba" in ext and f7 == 0x10 and f3 in (2, 4, 6):
+                shift = f3 // 2
+                return alu_rr(lambda a, b: (a << shift) + b), "alu"
+            if "zbb" in ext:
+                compute = self.zbb_binary(f7, f3, xlen, signed)
+                if compute:
+                    return alu_rr(compute), "alu"
+                if f7 == 0x04 and f3 == 4 and rs2 == 0 and xlen == 32:     # zext.h
+                    return alu_rr(lambda a, b: a & 0xFFFF), "alu"
+            if "zbs" in ext:
+                compute = self.zbs_binary(f7, f3)
+                if compute:
+                    return alu_rr(lambda a, b: compute(a, b & (xlen - 1))), "alu"
+            if f7 == 0x05 and ("zbc" in ext and f3 in (1, 2, 3) or "zbkc" in ext and f3 in (1, 3)):
+                return alu_rr(self.clmul(f3, xlen)), "mul"
+            if "zicond" in ext and f7 == 0x07 and f3 in (5, 7):
+                if f3 == 5:
+                    return alu_rr(lambda a, b: a if b else 0), "alu"           # czero.eqz
+                return alu_rr(lambda a, b: 0 if b else a), "alu"               # czero.nez
+            return None
+
+        if op == 0x1B and xlen == 64:                   # OP-IMM-32
+            shamt = (inst >> 20) & 0x1F
+            if f3 == 0:
+                return alu_ri(lambda a, b: word(a + b), imm_i), "alu"
+            if f3 == 1 and f7 == 0:
+                return alu_ri(lambda a, b: word(a << b), shamt), "alu"
+            if f3 == 5 and f7 == 0:
+                return alu_ri(lambda a, b: word((a & 0xFFFFFFFF) >> b), shamt), "alu"
+            if f3 == 5 and f7 == 0x20:
+                return alu_ri(lambda a, b: word(a) >> b, shamt), "alu"
+            if "zba" in ext and f3 == 1 and inst >> 26 == 0x02:         # slli.uw
+                shamt = (inst >> 20) & 0x3F
+                return alu_ri(lambda a, b: (a & 0xFFFFFFFF) << b, shamt), "alu"
+            if "zbb" in ext:
+                if f3 == 1 and f7 == 0x30:
+                    unary = {0: lambda a: 32 - (a & 0xFFFFFFFF).bit_length(),
+                             1: lambda a: ((a & -a) & 0xFFFFFFFF).bit_length() - 1 if a & 0xFFFFFFFF else 32,
+                             2: lambda a: bin(a & 0xFFFFFFFF).count("1")}.get(rs2)
+                    if unary:
+                        return alu_ri(lambda a, b: unary(a), 0), "alu"
+                if f3 == 5 and f7 == 0x30:                                 # roriw
+                    return alu_ri(lambda a, b: word(((a & 0xFFFFFFFF) >> b | a << (32 - b)) if b else a),
+                                  shamt), "alu"
+            return None
+
+        if op == 0x3B and xlen == 64:                   # OP-32
+            if f7 == 0x00:
+                table = {
+                    0: lambda a, b: word(a + b),
+                    1: lambda a, b: word(a << (b & 31)),
+                    5: lambda a, b: word((a & 0xFFFFFFFF) >> (b & 31)),
+                }
+                return (alu_rr(table[f3]), "alu") if f3 in table else None
+            if f7 == 0x20:
+                table = {
+                    0: lambda a, b: word(a - b),
+                    5: lambda a, b: word(a) >> (b & 31),
+                }
+                return (alu_rr(table[f3]), "alu") if f3 in table else None
+            if f7 == 0x01 and ("m" in ext or ("zmmul" in ext and f3 == 0)):
+                return self.muldiv_word(f3, word, alu_rr)
+            if "zba" in ext:
+                if f7 == 0x04 and f3 == 0:                                  # add.uw
+                    return alu_rr(lambda a, b: (a & 0xFFFFFFFF) + b), "alu"
+                if f7 == 0x10 and f3 in (2, 4, 6):                         # shNadd.uw
+                    shift = f3 // 2
+                    return alu_rr(lambda a, b: ((a & 0xFFFFFFFF) << shift) + b), "alu"
+            if "zbb" in ext:
+                if f7 == 0x04 and f3 == 4 and rs2 == 0:                    # zext.h
+                    return alu_rr(lambda a, b: a & 0xFFFF), "alu"
+                if f7 == 0x30 and f3 in (1, 5):                            # rolw / rorw
+                    def rotate(a, b, left=f3 == 1):
+                        a &= 0xFFFFFFFF
+                        b = (b & 31) if left else (32 - (b & 31)) & 31
+                        return word(a << b | a >> (32 - b))
+                    return alu_rr(rotate), "alu"
+            return None
+
+        if op == 0x0F:                                  # fence / fence.i
+            if f3 == 0:
+                return nop, "fence"
+            if f3 == 1:
+                cache = self.cache
+
+                def fence_i(pc):
+                    cache.clear()
+                    return pc + size
+                return fence_i, "fence"
+            if f3 == 2 and rd == 0 and inst >> 20 == 4 and "zicboz" in ext:      # cbo.zero
+                block = self.cbo_block
+                store64 = self.store64
+
+                def cbo_zero(pc):
+                    base = x[rs1] & ~(block - 1) & mask
+                    for offset in range(0, block, 8):
+                        store64(base + offset, 0)
+                    return pc + size
+                return cbo_zero, "cbo"
+            return None
+
+        if op == 0x73:
+            return self.decode_system(inst, size, rd, f3, rs1)
+
+        if op == 0x2F and "a" in ext and (f3 == 2 or (f3 == 3 and xlen == 64)):
+            return self.decode_amo(inst, size, rd, f3, rs1, rs2, word)
+
+        if "zve32x" in ext and (op == 0x57 or (op in (0x07, 0x27) and f3 in (0, 5, 6, 7))):
+            return self.decode_vector(inst, size)
+
+        if op in (0x07, 0x27, 0x43, 0x47, 0x4B, 0x4F, 0x53) and "f" in ext:
+            return self.decode_fp(inst, size, op, rd, f3, rs1, rs2, imm_i, imm_s)
+
+        return None
+
+    # -- M ------------------------------------------------------------------
+
+    @staticmethod
+    def muldiv(f3, xlen, signed, alu_rr):
+        top = 1 << xlen
+
+        def div(a, b):
+            a, b = signed(a), signed(b)
+            if b == 0:
+                return -1
+            if a == -(top >> 1) and b == -1:
+                return a
+            q = abs(a) // abs(b)
+            return q if (a < 0) == (b < 0) else -q
+
+        def rem(a, b):
+            sa, sb = signed(a), signed(b)
+            if sb == 0:
+                return a
+            if sa == -(top >> 1) and sb == -1:
+                return 0
+            r = abs(sa) % abs(sb)
+            return -r if sa < 0 else r
+
+        table = {
+            0: (lambda a, b: a * b, "mul"),
+            1: (lambda a, b: (signed(a) * signed(b)) >> xlen, "mul"),
+            2: (lambda a, b: (signed(a) * b) >> xlen, "mul"),
+            3: (lambda a, b: (a * b) >> xlen, "mul"),
+            4: (div, "div"),
+            5: (lambda a, b: a // b if b else top - 1, "div"),
+            6: (rem, "div"),
+            7: (lambda a, b: a % b if b else a, "div"),
+        }
+        compute, kind = table[f3]
+        return alu_rr(compute), kind
+
+    @staticmethod
+    def muldiv_word(f3, word, alu_rr):
+        def div(a, b):
+            a, b = word(a), word(b)
+            if b == 0:
+                return -1
+            if a == -(1 << 31) and b == -1:
+                return a
+            q = abs(a) // abs(b)
+            return word(q if (a < 0) == (b < 0) else -q)
+
+        def rem(a, b):
+            sa, sb = word(a), word(b)
+            if sb == 0:
+                return sa
+            if sa == -(1 << 31) and sb == -1:
+                return 0
+            r = abs(sa) % abs(sb)
+            return -r if sa < 0 else r
+
+        table = {
+            0: (lambda a, b: word(a * b), "mul"),
+            4: (div, "div"),
+            5: (lambda a, b: word((a & 0xFFFFFFFF) // (b & 0xFFFFFFFF)) if b & 0xFFFFFFFF else -1, "div"),
+            6: (rem, "div"),
+            7: (lambda a, b: word((a & 0xFFFFFFFF) % (b & 0xFFFFFFFF)) if b & 0xFFFFFFFF else word(a), "div"),
+        }
+        if f3 not in table:
+            return None
+        compute, kind = table[f3]
+        return alu_rr(compute), kind
+
+    # -- Zbb ----------------------------------------------------------------
+
+    @staticmethod
+    def zbb_unary(funct12, xlen):
+        return {
+            0x600: lambda a: xlen - a.bit_length(),                            # clz
+            0x601: lambda a: (a & -a).bit_length() - 1 if a else xlen,         # ctz
+            0x602: lambda a: bin(a).count("1"),                                # cpop
+            0x604: lambda a: sext(a, 8),                                       # sext.b
+            0x605: lambda a: sext(a, 16),                                      # sext.h
+        }.get(funct12)
+
+    @staticmethod
+    def zbb_binary(f7, f3, xlen, signed):
+        def rol(a, b):
+            b &= xlen - 1
+            return a << b | a >> (xlen - b)
+
+        def ror(a, b):
+            b &= xlen - 1
+            return a >> b | a << (xlen - b)
+
+        return {
+            (0x20, 7): lambda a, b: a & ~b,                                    # andn
+            (0x20, 6): lambda a, b: a | ~b,                                    # orn
+            (0x20, 4): lambda a, b: ~(a ^ b),                                  # xnor
+            (0x05, 4): lambda a, b: a if signed(a) < signed(b) else b,         # min
+            (0x05, 5): lambda a, b: a if a < b else b,                         # minu
+            (0x05, 6): lambda a, b: a if signed(a) > signed(b) else b,         # max
+            (0x05, 7): lambda a, b: a if a > b else b,                         # maxu
+            (0x30, 1): rol,
+            (0x30, 5): ror,
+        }.get((f7, f3))
+
+    # -- Zcmp ---------------------------------------------------------------
+
+    def decode_zcmp(self, h):
+        """
+        (handler, cycles) for cm.push/pop/popret/popretz/mvsa01/mva01s.
+        A push or pop costs a store or load per register.
+        """
+        x = self.x
+        mask = self.mask
+        # s0-s7 as encoded in cm.mvsa01/cm.mva01s
+        sregs = (8, 9, 18, 19, 20, 21, 22, 23)
+
+        if bits(h, 12, 10) == 3:
+            r1s, r2s = sregs[bits(h, 9, 7)], sregs[bits(h, 4, 2)]
+            if bits(h, 6, 5) == 1 and r1s != r2s:
+                def mvsa01(pc):
+                    x[r1s], x[r2s] = x[10], x[11]
+                    return pc + 2
+                return mvsa01, 2 * self.costs["alu"]
+            if bits(h, 6, 5) == 3:
+                def mva01s(pc):
+                    x[10], x[11] = x[r1s], x[r2s]
+                    return pc + 2
+                return mva01s, 2 * self.costs["alu"]
+            return None
+
+        op = bits(h, 12, 8)
+        rlist = bits(h, 7, 4)
+        if op not in (0x18, 0x1A, 0x1C, 0x1E) or rlist < 4:
+            return None
+        # {ra}, {ra, s0}, ... {ra, s0-s9}, then {ra, s0-s11} (no s0-s10)
+        regs = (1, 8, 9, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27)[:rlist - 3 if rlist < 15 else 13]
+        width = self.xlen // 8
+        adjust = (len(regs) * width + 15 & ~15) + bits(h, 3, 2) * 16
+        # Highest register at the top of the frame, ra at the bottom
+        slots = [(reg, -(i + 1) * width) for i, reg in enumerate(reversed(regs))]
+
+        if op == 0x18:                                  # cm.push
+            store = self.store32 if width == 4 else self.store64
+
+            def push(pc):
+                sp = x[2]
+                for reg, offset in slots:
+                    store((sp + offset) & mask, x[reg])
+                x[2] = (sp - adjust) & mask
+                return pc + 2
+            return push, len(regs) * self.costs["store"]
+
+        load = self.load32u if width == 4 else self.load64
+        ret = op != 0x1A
+        zero = op == 0x1C
+
+        def pop(pc):                                    # cm.pop / cm.popretz / cm.popret
+            sp = (x[2] + adjust) & mask
+            for reg, offset in slots:
+                x[reg] = load((sp + offset) & mask)
+            x[2] = sp
+            if not ret:
+                return pc + 2
+            if zero:
+                x[10] = 0
+            return x[1] & ~1
+        return pop, len(regs) * self.costs["load"]
+
+    # -- Zbs / Zbc ----------------------------------------------------------
+
+    @staticmethod
+    def zbs_binary(f7, f3):
+        """bclr/bext/binv/bset by funct7 (the immediate forms pass funct6 << 1)."""
+        return {
+            (0x24, 1): lambda a, b: a & ~(1 << b),                             # bclr
+            (0x24, 5): lambda a, b: a >> b & 1,                                # bext
+            (0x34, 1): lambda a, b: a ^ 1 << b,                                # binv
+            (0x14, 1): lambda a, b: a | 1 << b,                                # bset
+        }.get((f7, f3))
+
+    @staticmethod
+    def clmul(f3, xlen):
+        """Carry-less multiply: clmul (low half), clmulr (bits 2*XLEN-2..XLEN-1), clmulh."""
+        shift = {1: 0, 2: xlen - 1, 3: xlen}[f3]
+
+        def compute(a, b):
+            product = 0
+            while b:
+                low = b & -b
+                product ^= a * low
+                b ^= low
+            return product >> shift
+        return compute
+
+    # -- SYSTEM -------------------------------------------------------------
+
+    def decode_system(self, inst, size, rd, f3, rs1):
+        x = self.x
+        machine = self
+
+        if f3 == 0:
+            if inst == 0x00000073:                      # ecall
+                def ecall(pc):
+                    if x[17] == 93:
+                        machine.flush_output()
+                        code = machine.signed(x[10])
+                        raise Halt("exit", f"exit({code}) at 0x{pc:x}", code)
+                    if x[17] == 64:
+                        # write(fd, buf, len) to the console
+                        data = bytes(machine.load8u(x[11] + i) for i in range(x[12]))
+                        machine.uart.append(data.decode(errors="replace"))
+                        machine.flush_output()
+                        x[10] = x[12]
+                        return pc + size
+                    return machine.trap(pc, 11)
+                return ecall, "system"
+            if inst == 0x00100073:                      # ebreak
+                def ebreak(pc):
+                    raise Halt("ebreak", f"ebreak at 0x{pc:x}")
+                return ebreak, "system"
+            if inst == 0x30200073:                      # mret
+                def mret(pc):
+                    return machine.read_csr(0x341)
+                return mret, "system"
+            if inst == 0x10500073:                      # wfi (no interrupts: nop)
+                return (lambda pc: pc + size), "system"
+            return None
+
+        csr = inst >> 20
+        immediate = f3 >= 5
+        kind = f3 & 3
+        if kind == 0:
+            return None
+
+        def csr_op(pc):
+            old = machine.read_csr(csr)
+            operand = rs1 if immediate else x[rs1]
+            if kind == 1:
+                machine.write_csr(csr, operand)
+            elif rs1:                                   # csrrs/csrrc with rs1=0 only read
+                machine.write_csr(csr, old | operand if kind == 2 else old & ~operand)
+            if rd:
+                x[rd] = old & machine.mask
+            return pc + size
+        return csr_op, "csr"
+
+    def trap(self, pc: int, cause: int) -> int:
+        """Enter the trap handler, or stop if the program never set one up."""
+        vector = self.csr.get(0x305, 0) & ~3
+        if not vector:
+            raise Halt("trap", f"unhandled trap (mcause {cause}) at 0x{pc:x}")
+        self.csr[0x341] = pc
+        self.csr[0x342] = cause
+        return vector
+
+    def signed(self, value: int) -> int:
+        return value - (1 << self.xlen) if value >> (self.xlen - 1) else value
+
+    # -- A ------------------------------------------------------------------
+
+    def decode_amo(self, inst, size, rd, f3, rs1, rs2, word):
+        x = self.x
+        machine = self
+        funct5 = inst >> 27
+        is_word = f3 == 2
+        load = self.load32 if is_word and self.xlen == 64 else (self.load32u if is_word else self.load64)
+        store = self.store32 if is_word else self.store64
+        width = 32 if is_word else self.xlen
+        signed = (lambda v: sext(v, width))
+        mask = self.mask
+
+        if funct5 == 0x02:                              # lr
+            def lr(pc):
+                addr = x[rs1]
+                value = load(addr)
+                machine.reservation = addr
+                if rd:
+                    x[rd] = value
+                return pc + size
+            return lr, "amo"
+        if funct5 == 0x03:                              # sc
+            def sc(pc):
+                addr = x[rs1]
+                ok = machine.reservation == addr
+                if ok:
+                    store(addr, x[rs2])
+                machine.reservation = None
+                if rd:
+                    x[rd] = 0 if ok else 1
+                return pc + size
+            return sc, "amo"
+
+        operations = {
+            0x01: lambda a, b: b,
+            0x00: lambda a, b: a + b,
+            0x04: lambda a, b: a ^ b,
+            0x0C: lambda a, b: a & b,
+            0x08: lambda a, b: a | b,
+            0x10: lambda a, b: a if signed(a) < signed(b) else b,
+            0x14: lambda a, b: a if signed(a) > signed(b) else b,
+            0x18: lambda a, b: a if (a & ((1 << width) - 1)) < (b & ((1 << width) - 1)) else b,
+            0x1C: lambda a, b: a if (a & ((1 << width) - 1)) > (b & ((1 << width) - 1)) else b,
+        }
+        if funct5 not in operations:
+            return None
+        operation = operations[funct5]
+
+        def amo(pc):
+            addr = x[rs1]
+            old = load(addr)
+            store(addr, operation(old, x[rs2]))
+            if rd:
+                x[rd] = old & mask
+            return pc + size
+        return amo, "amo"
+
+    # -- F / D --------------------------------------------------------------
+
+    def decode_fp(self, inst, size, op, rd, f3, rs1, rs2, imm_i, imm_s):
+        x = self.x
+        f = self.f
+        machine = self
+        mask = self.mask
+        xlen = self.xlen
+
+        if op in (0x07, 0x27):                          # flw/fld, fsw/fsd
+            if f3 == 2:
+                load, store = self.load32u, self.store32
+                to_float = lambda v: F32.unpack(U32.pack(v))[0]
+                to_bits = lambda v: U32.unpack(F32.pack(v))[0]
+            elif f3 == 3 and "d" in self.extensions:
+                load, store = self.load64, self.store64
+                to_float = lambda v: F64.unpack(U64.pack(v))[0]
+                to_bits = lambda v: U64.unpack(F64.pack(v))[0]
+            else:
+                return None
+            if op == 0x07:
+                def fload(pc):
+                    f[rd] = to_float(load((x[rs1] + imm_i) & mask))
+                    return pc + size
+                return fload, "load"
+
+            def fstore(pc):
+                store((x[rs1] + imm_s) & mask, to_bits(f[rs2]))
+                return pc + size
+            return fstore, "store"
+
+        fmt = (inst >> 25) & 3
+        if fmt > 1 or (fmt == 1 and "d" not in self.extensions):
+            return None
+        rnd = f32 if fmt == 0 else float
+
+        if op != 0x53:                                  # fused multiply-add
+            rs3 = inst >> 27
+
+            def fused(product_sign, addend_sign):
+                def fma(pc):
+                    f[rd] = rnd(product_sign * (f[rs1] * f[rs2]) + addend_sign * f[rs3])
+                    return pc + size
+                return fma
+            signs = {0x43: (1, 1), 0x47: (1, -1), 0x4B: (-1, 1), 0x4F: (-1, -1)}[op]
+            return fused(*signs), "fma"
+
+        funct5 = inst >> 27
+
+        def binary(compute, kind="fpu"):
+            def fn(pc):
+                f[rd] = rnd(compute(f[rs1], f[rs2]))
+                return pc + size
+            return fn, kind
+
+        if funct5 == 0x00:
+            return binary(lambda a, b: a + b)
+        if funct5 == 0x01:
+            return binary(lambda a, b: a - b)
+        if funct5 == 0x02:
+            return binary(lambda a, b: a * b)
+        if funct5 == 0x03:
+            return binary(float_divide, "fdiv")
+        if funct5 == 0x0B and rs2 == 0:
+            return binary(lambda a, b: math.sqrt(a) if a >= 0 else math.nan, "fsqrt")
+        if funct5 == 0x04:
+            if f3 == 0:
+                return binary(lambda a, b: math.copysign(a, b), "fmisc")
+            if f3 == 1:
+                return binary(lambda a, b: math.copysign(a, -math.copysign(1, b)), "fmisc")
+            if f3 == 2:
+                return binary(lambda a, b: math.copysign(a, math.copysign(1, a) * math.copysign(1, b)), "fmisc")
+            return None
+        if funct5 == 0x05 and f3 in (0, 1):
+            return binary(lambda a, b, want_max=f3 == 1: float_min_max(a, b, want_max), "fmisc")
+        if funct5 == 0x08:                              # fcvt.s.d / fcvt.d.s
+            def convert(pc):
+                f[rd] = rnd(f[rs1])
+                return pc + size
+            return convert, "fmisc"
+        if funct5 == 0x14 and f3 in (0, 1, 2):
+            compare = {2: lambda a, b: a == b, 1: lambda a, b: a < b, 0: lambda a, b: a <= b}[f3]
+
+            def fcmp(pc):
+                if rd:
+                    x[rd] = int(compare(f[rs1], f[rs2]))
+                return pc + size
+            return fcmp, "fmisc"
+        if funct5 == 0x18 and rs2 < (4 if xlen == 64 else 2):       # fcvt.{w,wu,l,lu}.{s,d}
+            width = 32 if rs2 < 2 else 64
+            is_signed = rs2 in (0, 2)
+            low, high = (-(1 << (width - 1)), (1 << (width - 1)) - 1) if is_signed else (0, (1 << width) - 1)
+
+            def to_int(pc):
+                mode = f3 if f3 != 7 else machine.csr.get(0x002, 0)
+                result = float_to_int(f[rs1], low, high, mode)
+                if rd:
+                    x[rd] = sext(result, 32) & mask if width == 32 else result & mask
+                return pc + size
+            return to_int, "fmisc"
+        if funct5 == 0x1A and rs2 < (4 if xlen == 64 else 2):       # fcvt.{s,d}.{w,wu,l,lu}
+            width = 32 if rs2 < 2 else 64
+            is_signed = rs2 in (0, 2)
+
+            def from_int(pc):
+                value = x[rs1] & ((1 << width) - 1)
+                if is_signed:
+                    value = sext(value, width)
+                f[rd] = rnd(float(value))
+                return pc + size
+            return from_int, "fmisc"
+        if funct5 == 0x1C and rs2 == 0 and f3 == 0:                 # fmv.x.w / fmv.x.d
+            if fmt == 0:
+                def fmv_x(pc):
+                    if rd:
+                        x[rd] = sext(U32.unpack(F32.pack(f[rs1]))[0], 32) & mask
+                    return pc + size
+            else:
+                def fmv_x(pc):
+                    if rd:
+                        x[rd] = U64.unpack(F64.pack(f[rs1]))[0]
+                    return pc + size
+            return fmv_x, "fmisc"
+        if funct5 == 0x1C and rs2 == 0 and f3 == 1:                 # fclass
+            smallest = 1.17549435e-38 if fmt == 0 else 2.2250738585072014e-308
+
+            def fclass(pc):
+                value = f[rs1]
+                negative = math.copysign(1, value) < 0
+                if math.isnan(value):
+                    result = 1 << 9
+                elif math.isinf(value):
+                    result = 1 << (0 if negative else 7)
+                elif value == 0:
+                    result = 1 << (3 if negative else 4)
+                elif abs(value) < smallest:
+                    result = 1 << (2 if negative else 5)
+                else:
+                    result = 1 << (1 if negative else 6)
+                if rd:
+                    x[rd] = result
+                return pc + size
+            return fclass, "fmisc"
+        if funct5 == 0x1E and rs2 == 0 and f3 == 0:                 # fmv.w.x / fmv.d.x
+            if fmt == 0:
+                def fmv_f(pc):
+                    f[rd] = F32.unpack(U32.pack(x[rs1] & 0xFFFFFFFF))[0]
+                    return pc + size
+            else:
+                def fmv_f(pc):
+                    f[rd] = F64.unpack(U64.pack(x[rs1]))[0]
+                    return pc + size
+            return fmv_f, "fmisc"
+        return None
+
+    # -- V ------------------------------------------------------------------
+
+    def set_vtype(self, vtype: int, avl: int) -> int:
+        """vsetvl: switch to vtype with vl = min(avl, VLMAX). Returns vl."""
+        vsew = (vtype >> 3) & 7
+        vlmul = vtype & 7
+        sew = 8 << vsew
+        lmul8 = 8 << vlmul if vlmul < 4 else 8 >> (8 - vlmul)      # LMUL * 8
+        vlmax = self.vlen * lmul8 // 8 // sew
+        if vtype >> 8 or vsew > 3 or vlmul == 4 or sew > self.elen or sew * 8 > lmul8 * self.elen or not vlmax:
+            # Unsupported: vill set, vector instructions are illegal until the next vsetvl
+            self.vtype = 1 << (self.xlen - 1)
+            self.vsew = self.vlmax = self.vl = 0
+            self.vlmul8 = 8
+            return 0
+        self.vtype = vtype
+        self.vsew = sew
+        self.vlmul8 = lmul8
+        self.vlmax = vlmax
+        self.vl = min(avl, vlmax)
+        return self.vl
+
+    def decode_vector(self, inst, size):
+        """
+        (handler, cost class) for a vector instruction, or None if illegal.
+        Masked-off and tail elements are left undisturbed.
+        """
+        x = self.x
+        f = self.f
+        v = self.v
+        machine = self
+        mask = self.mask
+        xlen = self.xlen
+        vlen = self.vlen
+        vlenb = self.vlenb
+        ext = self.extensions
+
+        op = inst & 0x7F
+        vd = (inst >> 7) & 0x1F
+        f3 = (inst >> 12) & 7
+        rs1 = (inst >> 15) & 0x1F
+        vs2 = (inst >> 20) & 0x1F
+        vm = (inst >> 25) & 1
+        funct6 = inst >> 26
+
+        # Element i of the register group starting at reg, 'width' bits wide
+        def get(reg, i, width):
+            n = width >> 3
+            off = reg * vlenb + i * n
+            return int.from_bytes(v[off:off + n], "little")
+
+        def put(reg, i, width, value):
+            n = width >> 3
+            off = reg * vlenb + i * n
+            v[off:off + n] = (value & ((1 << width) - 1)).to_bytes(n, "little")
+
+        def bit(reg, i):
+            return v[reg * vlenb + (i >> 3)] >> (i & 7) & 1
+
+        def set_bit(reg, i, value):
+            off = reg * vlenb + (i >> 3)
+            v[off] = v[off] & ~(1 << (i & 7)) | (value & 1) << (i & 7)
+
+        def illegal(pc, why):
+            return Halt("illegal", f"illegal vector instruction 0x{inst:08x} at 0x{pc:x} ({why})")
+
+        def state(pc, fp=False):
+            """(SEW, vl), checking vtype is valid (and a floating-point SEW)."""
+            sew = machine.vsew
+            if not sew:
+                raise illegal(pc, "vtype not set")
+            if fp and not (sew == 32 and "zve32f" in ext or sew == 64 and "zve64d" in ext):
+                raise illegal(pc, f"no {sew}-bit floating point")
+            return sew, machine.vl
+
+        def group(sew, width):
+            """Registers in a group of 'width'-bit elements (EMUL = width / SEW * LMUL)."""
+            return max(machine.vlmul8 * width // sew >> 3, 1)
+
+        def check(pc, sew, *groups):
+            """Register groups (reg, element width) must fit ELEN and EMUL <= 8 and be aligned."""
+            for reg, width in groups:
+                regs = machine.vlmul8 * width // sew >> 3
+                if width > machine.elen or regs > 8 or (regs and reg & (regs - 1)):
+                    raise illegal(pc, f"v{reg} with {width}-bit elements")
+
+        def beats(count):
+            """Add a cycle for every VLEN bits of elements past the first."""
+            if count > vlen:
+                machine.cycles += (count - 1) // vlen
+
+        def to_float(value, width):
+            return F32.unpack(U32.pack(value))[0] if width == 32 else F64.unpack(U64.pack(value))[0]
+
+        def from_float(value, width):
+            return U32.unpack(F32.pack(f32(value)))[0] if width == 32 else U64.unpack(F64.pack(value))[0]
+
+        def float_round(value, width):
+            return f32(value) if width == 32 else value
+
+        if op == 0x57 and f3 == 7:                      # vsetvli / vsetivli / vsetvl
+            rd = vd
+            if inst >> 31 == 0:
+                vtype = (inst >> 20) & 0x7FF
+            elif inst >> 30 == 3:
+                vtype = (inst >> 20) & 0x3FF
+            elif inst >> 25 == 0x40:
+                vtype = None
+            else:
+                return None
+            immediate = inst >> 30 == 3
+
+            def vset(pc):
+                if immediate:
+                    avl = rs1
+                elif rs1:
+                    avl = x[rs1]
+                elif rd:
+                    avl = 1 << 64                       # VLMAX
+                else:
+                    avl = machine.vl                    # keep vl
+                vl = machine.set_vtype(x[vs2] if vtype is None else vtype, avl)
+                if rd:
+                    x[rd] = vl
+                return pc + size
+            return vset, "vset"
+
+        if op in (0x07, 0x27):                          # loads and stores
+            return self.decode_vector_memory(inst, size, get, put, state, group, check, beats, illegal)
+
+        # Second operand: vs1, or a scalar from x[rs1], f[rs1] or the
+        # 5-bit immediate (sign-extended, unsigned for shifts and slides)
+        if f3 in (0, 1, 2):
+            operand = None
+        elif f3 == 3:
+            imm = rs1 if funct6 in (0x0C, 0x0E, 0x0F, 0x25, 0x28, 0x29, 0x2C, 0x2D) else sext(rs1, 5)
+            operand = lambda width: imm & ((1 << width) - 1)
+        elif f3 in (4, 6):
+            operand = lambda width: sext(x[rs1], xlen) & ((1 << width) - 1)
+        else:
+            operand = lambda width: f[rs1]
+
+        def elementwise(compute, kind, dest=1, src2=1, fp=False, fp_bits=False, accumulate=False,
+                        to_mask=False, unary=False):
+            """
+            vd[i] = compute(vs2[i], vs1[i] or the scalar, old vd[i], SEW) for
+            the active elements, with vd 'dest' and vs2 'src2' times SEW wide.
+            fp: the operands and result are floats (fp_bits: raw bits, but SEW
+            must be a floating-point width). to_mask: the result is a mask bit.
+            """
+            def fn(pc):
+                sew, vl = state(pc, fp or fp_bits)
+                wd, w2 = sew * dest, sew * src2
+                check(pc, sew, (vs2, w2), *(() if operand or unary else ((rs1, sew),)),
+                      *(() if to_mask else ((vd, wd),)))
+                b = operand(sew) if operand else 0
+                for i in range(vl):
+                    if not vm and not bit(0, i):
+                        continue
+                    a = get(vs2, i, w2)
+                    c = b if operand or unary else get(rs1, i, sew)
+                    d = get(vd, i, wd) if accumulate else 0
+                    if fp:
+                        a = to_float(a, w2)
+                        if not operand:
+                            c = to_float(c, sew)
+                        if accumulate:
+                            d = to_float(d, wd)
+                    result = compute(a, c, d, sew)
+                    if to_mask:
+                        set_bit(vd, i, int(result))
+                    else:
+                        put(vd, i, wd, from_float(result, wd) if fp else result)
+                beats(vl * max(wd, w2))
+                return pc + size
+            return fn, kind
+
+        def reduction(compute, kind, wide=1, fp=False):
+            """vd[0] = compute(...compute(vs1[0], vs2[0])..., vs2[vl-1]) over the active elements."""
+            def fn(pc):
+                sew, vl = state(pc, fp)
+                width = sew * wide
+                check(pc, sew, (vs2, sew))
+                if width > machine.elen:
+                    raise illegal(pc, f"{width}-bit elements")
+                if vl:
+                    acc = get(rs1, 0, width)
+                    if fp:
+                        acc = to_float(acc, width)
+                    for i in range(vl):
+                        if vm or bit(0, i):
+                            a = get(vs2, i, sew)
+                            if fp:
+                                acc = float_round(compute(acc, to_float(a, sew), sew), width)
+                            else:
+                                acc = compute(acc, a, sew)
+                    put(vd, 0, width, from_float(acc, width) if fp else acc)
+                beats(vl * sew)
+                return pc + size
+            return fn, kind
+
+        def merge(scalar):
+            """vmerge / vmv.v (vm=1): vd[i] = v0[i] ? (vs1[i] or scalar) : vs2[i]."""
+            if vm and vs2:
+                return None
+
+            def fn(pc):
+                sew, vl = state(pc, f3 == 5)
+                check(pc, sew, (vd, sew), (vs2, sew), *(() if scalar else ((rs1, sew),)))
+                b = scalar(sew) if scalar else 0
+                for i in range(vl):
+                    if vm or bit(0, i):
+                        put(vd, i, sew, b if scalar else get(rs1, i, sew))
+                    else:
+                        put(vd, i, sew, get(vs2, i, sew))
+                beats(vl * sew)
+                return pc + size
+            return fn, "valu"
+
+        def slide1(up, scalar):
+            """vslide1up / vslide1down: shift by one element, the scalar fills the gap."""
+            def fn(pc):
+                sew, vl = state(pc, f3 == 5)
+                check(pc, sew, (vd, sew), (vs2, sew))
+                value = scalar(sew)
+                for i in range(vl):
+                    if vm or bit(0, i):
+                        if up:
+                            put(vd, i, sew, get(vs2, i - 1, sew) if i else value)
+                        else:
+                            put(vd, i, sew, get(vs2, i + 1, sew) if i < vl - 1 else value)
+                beats(vl * sew)
+                return pc + size
+            return fn, "valu"
+
+        def signed(a, b, width):
+            return sext(a, width), sext(b, width)
+
+        if f3 in (0, 3, 4):                             # OPIVV / OPIVI / OPIVX
+            integer = {
+                0x00: lambda a, b, d, w: a + b,
+                0x02: lambda a, b, d, w: a - b,
+                0x03: lambda a, b, d, w: b - a,
+                0x04: lambda a, b, d, w: min(a, b),
+                0x05: lambda a, b, d, w: a if sext(a, w) < sext(b, w) else b,
+                0x06: lambda a, b, d, w: max(a, b),
+                0x07: lambda a, b, d, w: a if sext(a, w) > sext(b, w) else b,
+                0x09: lambda a, b, d, w: a & b,
+                0x0A: lambda a, b, d, w: a | b,
+                0x0B: lambda a, b, d, w: a ^ b,
+                0x25: lambda a, b, d, w: a << (b & (w - 1)),
+                0x28: lambda a, b, d, w: a >> (b & (w - 1)),
+                0x29: lambda a, b, d, w: sext(a, w) >> (b & (w - 1)),
+            }
+            compares = {
+                0x18: lambda a, b, d, w: a == b,
+                0x19: lambda a, b, d, w: a != b,
+                0x1A: lambda a, b, d, w: a < b,
+                0x1B: lambda a, b, d, w: sext(a, w) < sext(b, w),
+                0x1C: lambda a, b, d, w: a <= b,
+                0x1D: lambda a, b, d, w: sext(a, w) <= sext(b, w),
+                0x1E: lambda a, b, d, w: a > b,
+                0x1F: lambda a, b, d, w: sext(a, w) > sext(b, w),
+            }
+            if funct6 in integer:
+                return elementwise(integer[funct6], "valu")
+            if funct6 in compares:
+                return elementwise(compares[funct6], "valu", to_mask=True)
+            if funct6 == 0x2C:                          # vnsrl
+                return elementwise(lambda a, b, d, w: a >> (b & (2 * w - 1)), "valu", src2=2)
+            if funct6 == 0x2D:                          # vnsra
+                return elementwise(lambda a, b, d, w: sext(a, 2 * w) >> (b & (2 * w - 1)), "valu", src2=2)
+            if funct6 == 0x17:                          # vmerge / vmv.v
+                return merge(operand)
+            if funct6 == 0x0C or (funct6 == 0x0E and f3 == 0):     # vrgather / vrgatherei16
+                index_width = 16 if funct6 == 0x0E else None
+
+                def gather(pc):
+                    sew, vl = state(pc)
+                    width = index_width or sew
+                    check(pc, sew, (vd, sew), (vs2, sew), *(() if f3 else ((rs1, width),)))
+                    vlmax = machine.vlmax
+                    scalar = x[rs1] if f3 == 4 else rs1
+                    for i in range(vl):
+                        if vm or bit(0, i):
+                            index = get(rs1, i, width) if f3 == 0 else scalar
+                            put(vd, i, sew, get(vs2, index, sew) if index < vlmax else 0)
+                    beats(vl * sew)
+                    return pc + size
+                return gather, "valu"
+            if funct6 in (0x0E, 0x0F):                  # vslideup / vslidedown
+                up = funct6 == 0x0E
+
+                def slide(pc):
+                    sew, vl = state(pc)
+                    check(pc, sew, (vd, sew), (vs2, sew))
+                    offset = x[rs1] if f3 == 4 else rs1
+                    vlmax = machine.vlmax
+                    for i in range(offset if up else 0, vl):
+                        if vm or bit(0, i):
+                            j = i - offset if up else i + offset
+                            put(vd, i, sew, get(vs2, j, sew) if j < vlmax else 0)
+                    beats(vl * sew)
+                    return pc + size
+                return slide, "valu"
+            if funct6 == 0x27 and f3 == 3:              # vmv<nr>r.v
+                count = rs1 + 1
+                if count not in (1, 2, 4, 8) or vd & (count - 1) or vs2 & (count - 1):
+                    return None
+
+                def move_whole(pc):
+                    v[vd * vlenb:(vd + count) * vlenb] = v[vs2 * vlenb:(vs2 + count) * vlenb]
+                    beats(count * vlen)
+                    return pc + size
+                return move_whole, "valu"
+            if funct6 in (0x30, 0x31) and f3 == 0:      # vwredsumu / vwredsum
+                if funct6 == 0x31:
+                    return reduction(lambda acc, a, w: acc + sext(a, w), "valu", wide=2)
+                return reduction(lambda acc, a, w: acc + a, "valu", wide=2)
+            return None
+
+        if f3 in (2, 6):                                # OPMVV / OPMVX
+            def divide(a, b, w, is_signed):
+                if is_signed:
+                    a, b = signed(a, b, w)
+                if b == 0:
+                    return -1
+                if is_signed and b == -1 and a == -(1 << (w - 1)):
+                    return a
+                quotient = abs(a) // abs(b)
+                return -quotient if (a < 0) != (b < 0) else quotient
+
+            def remainder(a, b, w, is_signed):
+                if is_signed:
+                    a, b = signed(a, b, w)
+                if b == 0:
+                    return a
+                if is_signed and b == -1:
+                    return 0
+                rest = abs(a) % abs(b)
+                return -rest if a < 0 else rest
+
+            arithmetic = {
+                0x20: (lambda a, b, d, w: divide(a, b, w, False), "vdiv"),
+                0x21: (lambda a, b, d, w: divide(a, b, w, True), "vdiv"),
+                0x22: (lambda a, b, d, w: remainder(a, b, w, False), "vdiv"),
+                0x23: (lambda a, b, d, w: remainder(a, b, w, True), "vdiv"),
+                0x24: (lambda a, b, d, w: (a * b) >> w, "vmul"),
+                0x25: (lambda a, b, d, w: a * b, "vmul"),
+                0x26: (lambda a, b, d, w: (sext(a, w) * b) >> w, "vmul"),
+                0x27: (lambda a, b, d, w: (sext(a, w) * sext(b, w)) >> w, "vmul"),
+            }
+            multiply_add = {
+                0x29: lambda a, b, d, w: b * d + a,     # vmadd
+                0x2B: lambda a, b, d, w: a - b * d,     # vnmsub
+                0x2D: lambda a, b, d, w: b * a + d,     # vmacc
+                0x2F: lambda a, b, d, w: d - b * a,     # vnmsac
+            }
+            # Widening: (compute, vs2 width, accumulates, kind)
+            widening = {
+                0x30: (lambda a, b, d, w: a + b, 1, False, "valu"),
+                0x31: (lambda a, b, d, w: sext(a, w) + sext(b, w), 1, False, "valu"),
+                0x32: (lambda a, b, d, w: a - b, 1, False, "valu"),
+                0x33: (lambda a, b, d, w: sext(a, w) - sext(b, w), 1, False, "valu"),
+                0x34: (lambda a, b, d, w: a + b, 2, False, "valu"),
+                0x35: (lambda a, b, d, w: sext(a, 2 * w) + sext(b, w), 2, False, "valu"),
+                0x36: (lambda a, b, d, w: a - b, 2, False, "valu"),
+                0x37: (lambda a, b, d, w: sext(a, 2 * w) - sext(b, w), 2, False, "valu"),
+                0x38: (lambda a, b, d, w: a * b, 1, False, "vmul"),
+                0x3A: (lambda a, b, d, w: sext(a, w) * b, 1, False, "vmul"),
+                0x3B: (lambda a, b, d, w: sext(a, w) * sext(b, w), 1, False, "vmul"),
+                0x3C: (lambda a, b, d, w: a * b + d, 1, True, "vmul"),
+                0x3D: (lambda a, b, d, w: sext(a, w) * sext(b, w) + d, 1, True, "vmul"),
+                0x3E: (lambda a, b, d, w: sext(a, w) * b + d, 1, True, "vmul"),
+                0x3F: (lambda a, b, d, w: a * sext(b, w) + d, 1, True, "vmul"),
+            }
+            reductions = {
+                0x00: lambda acc, a, w: acc + a,
+                0x01: lambda acc, a, w: acc & a,
+                0x02: lambda acc, a, w: acc | a,
+                0x03: lambda acc, a, w: acc ^ a,
+                0x04: lambda acc, a, w: min(acc, a),
+                0x05: lambda acc, a, w: acc if sext(acc, w) < sext(a, w) else a,
+                0x06: lambda acc, a, w: max(acc, a),
+                0x07: lambda acc, a, w: acc if sext(acc, w) > sext(a, w) else a,
+            }
+            mask_logic = {
+                0x18: lambda a, b: a & ~b,              # vmandn
+                0x19: lambda a, b: a & b,
+                0x1A: lambda a, b: a | b,
+                0x1B: lambda a, b: a ^ b,
+                0x1C: lambda a, b: a | ~b,              # vmorn
+                0x1D: lambda a, b: ~(a & b),
+                0x1E: lambda a, b: ~(a | b),
+                0x1F: lambda a, b: ~(a ^ b),
+            }
+            if funct6 in arithmetic:
+                return elementwise(*arithmetic[funct6])
+            if funct6 in multiply_add:
+                return elementwise(multiply_add[funct6], "vmul", accumulate=True)
+            if funct6 in widening:
+                compute, src2, accumulate, kind = widening[funct6]
+                if funct6 == 0x3E and f3 == 2:
+                    return None
+                return elementwise(compute, kind, dest=2, src2=src2, accumulate=accumulate)
+            if f3 == 2 and funct6 in reductions:
+                return reduction(reductions[funct6], "valu")
+            if f3 == 6 and funct6 in (0x0E, 0x0F):      # vslide1up / vslide1down
+                return slide1(funct6 == 0x0E, operand)
+            if f3 == 2 and funct6 in mask_logic:
+                compute = mask_logic[funct6]
+
+                def logic(pc):
+                    _, vl = state(pc)
+                    for i in range(vl):
+                        set_bit(vd, i, compute(bit(vs2, i), bit(rs1, i)))
+                    beats(vl)
+                    return pc + size
+                return logic, "valu"
+            if f3 == 2 and funct6 == 0x10 and rs1 == 0:                 # vmv.x.s
+                def move_to_x(pc):
+                    sew, _ = state(pc)
+                    if vd:
+                        x[vd] = sext(get(vs2, 0, sew), sew) & mask
+                    return pc + size
+                return move_to_x, "valu"
+            if f3 == 2 and funct6 == 0x10 and rs1 in (0x10, 0x11):      # vcpop.m / vfirst.m
+                def count_mask(pc):
+                    _, vl = state(pc)
+                    found = [i for i in range(vl) if bit(vs2, i) and (vm or bit(0, i))]
+                    if vd:
+                        if rs1 == 0x10:
+                            x[vd] = len(found)
+                        else:
+                            x[vd] = found[0] if found else mask
+                    beats(vl)
+                    return pc + size
+                return count_mask, "valu"
+            if f3 == 6 and funct6 == 0x10 and vs2 == 0:                 # vmv.s.x
+                def move_from_x(pc):
+                    sew, vl = state(pc)
+                    if vl:
+                        put(vd, 0, sew, sext(x[rs1], xlen))
+                    return pc + size
+                return move_from_x, "valu"
+            if f3 == 2 and funct6 == 0x12 and 2 <= rs1 <= 7:            # vzext / vsext
+                factor = 1 << (4 - rs1 // 2)
+                extend_sign = rs1 & 1
+
+                def extend(pc):
+                    sew, vl = state(pc)
+                    width = sew // factor
+                    if width < 8:
+                        raise illegal(pc, f"SEW {sew} too small")
+                    check(pc, sew, (vd, sew), (vs2, width))
+                    for i in range(vl):
+                        if vm or bit(0, i):
+                            a = get(vs2, i, width)
+                            put(vd, i, sew, sext(a, width) if extend_sign else a)
+                    beats(vl * sew)
+                    return pc + size
+                return extend, "valu"
+            if f3 == 2 and funct6 == 0x14 and rs1 in (1, 2, 3):         # vmsbf / vmsof / vmsif
+                def set_first(pc):
+                    _, vl = state(pc)
+                    found = False
+                    for i in range(vl):
+                        if not vm and not bit(0, i):
+                            continue
+                        first = bit(vs2, i)
+                        if rs1 == 1:
+                            result = not found and not first
+                        elif rs1 == 3:
+                            result = not found
+                        else:
+                            result = not found and first
+                        set_bit(vd, i, int(result))
+                        found = found or first
+                    beats(vl)
+                    return pc + size
+                return set_first, "valu"
+            if f3 == 2 and funct6 == 0x14 and rs1 in (0x10, 0x11):      # viota / vid
+                def index(pc):
+                    sew, vl = state(pc)
+                    check(pc, sew, (vd, sew))
+                    count = 0
+                    for i in range(vl):
+                        if vm or bit(0, i):
+                            put(vd, i, sew, i if rs1 == 0x11 else count)
+                            if rs1 == 0x10 and bit(vs2, i):
+                                count += 1
+                    beats(vl * sew)
+                    return pc + size
+                return index, "valu"
+            if f3 == 2 and funct6 == 0x17 and vm:                       # vcompress
+                def compress(pc):
+                    sew, vl = state(pc)
+                    check(pc, sew, (vd, sew), (vs2, sew))
+                    j = 0
+                    for i in range(vl):
+                        if bit(rs1, i):
+                            put(vd, j, sew, get(vs2, i, sew))
+                            j += 1
+                    beats(vl * sew)
+                    return pc + size
+                return compress, "valu"
+            return None
+
+        # OPFVV / OPFVF
+        arithmetic = {
+            0x00: (lambda a, b, d, w: a + b, "vfpu"),
+            0x02: (lambda a, b, d, w: a - b, "vfpu"),
+            0x24: (lambda a, b, d, w: a * b, "vfpu"),
+            0x20: (lambda a, b, d, w: float_divide(a, b), "vfdiv"),
+            0x04: (lambda a, b, d, w: float_min_max(a, b, False), "vfpu"),
+            0x06: (lambda a, b, d, w: float_min_max(a, b, True), "vfpu"),
+            0x08: (lambda a, b, d, w: math.copysign(a, b), "vfpu"),
+            0x09: (lambda a, b, d, w: math.copysign(a, -math.copysign(1, b)), "vfpu"),
+            0x0A: (lambda a, b, d, w: math.copysign(a, math.copysign(1, a) * math.copysign(1, b)), "vfpu"),
+        }
+        if f3 == 5:
+            arithmetic[0x27] = (lambda a, b, d, w: b - a, "vfpu")                  # vfrsub
+            arithmetic[0x21] = (lambda a, b, d, w: float_divide(b, a), "vfdiv")    # vfrdiv
+        compares = {
+            0x18: lambda a, b, d, w: a == b,
+            0x19: lambda a, b, d, w: a <= b,
+            0x1B: lambda a, b, d, w: a < b,
+            0x1C: lambda a, b, d, w: a != b,
+            0x1D: lambda a, b, d, w: a > b,
+            0x1F: lambda a, b, d, w: a >= b,
+        }
+        fused = {
+            0x28: lambda a, b, d, w: b * d + a,         # vfmadd
+            0x29: lambda a, b, d, w: -(b * d) - a,      # vfnmadd
+            0x2A: lambda a, b, d, w: b * d - a,         # vfmsub
+            0x2B: lambda a, b, d, w: a - b * d,         # vfnmsub
+            0x2C: lambda a, b, d, w: b * a + d,         # vfmacc
+            0x2D: lambda a, b, d, w: -(b * a) - d,      # vfnmacc
+            0x2E: lambda a, b, d, w: b * a - d,         # vfmsac
+            0x2F: lambda a, b, d, w: d - b * a,         # vfnmsac
+        }
+        # Widening: (compute, vs2 width, accumulates)
+        widening = {
+            0x30: (lambda a, b, d, w: a + b, 1, False),
+            0x32: (lambda a, b, d, w: a - b, 1, False),
+            0x34: (lambda a, b, d, w: a + b, 2, False),
+            0x36: (lambda a, b, d, w: a - b, 2, False),
+            0x38: (lambda a, b, d, w: a * b, 1, False),
+            0x3C: (lambda a, b, d, w: b * a + d, 1, True),
+            0x3D: (lambda a, b, d, w: -(b * a) - d, 1, True),
+            0x3E: (lambda a, b, d, w: b * a - d, 1, True),
+            0x3F: (lambda a, b, d, w: d - b * a, 1, True),
+        }
+        reductions = {
+            0x01: (lambda acc, a, w: acc + a, 1),       # vfredusum (in order)
+            0x03: (lambda acc, a, w: acc + a, 1),       # vfredosum
+            0x05: (lambda acc, a, w: float_min_max(acc, a, False), 1),
+            0x07: (lambda acc, a, w: float_min_max(acc, a, True), 1),
+            0x31: (lambda acc, a, w: acc + a, 2),       # vfwredusum
+            0x33: (lambda acc, a, w: acc + a, 2),       # vfwredosum
+        }
+        if funct6 in arithmetic:
+            compute, kind = arithmetic[funct6]
+            return elementwise(compute, kind, fp=True)
+        if funct6 in compares:
+            return elementwise(compares[funct6], "vfpu", fp=True, to_mask=True)
+        if funct6 in fused:
+            return elementwise(fused[funct6], "vfpu", fp=True, accumulate=True)
+        if funct6 in widening:
+            compute, src2, accumulate = widening[funct6]
+            return elementwise(compute, "vfpu", dest=2, src2=src2, fp=True, accumulate=accumulate)
+        if f3 == 1 and funct6 in reductions:
+            compute, wide = reductions[funct6]
+            return reduction(compute, "vfpu", wide=wide, fp=True)
+        if f3 == 5 and funct6 in (0x0E, 0x0F):          # vfslide1up / vfslide1down
+            return slide1(funct6 == 0x0E, lambda width: from_float(f[rs1], width))
+        if f3 == 5 and funct6 == 0x17:                  # vfmerge / vfmv.v.f
+            return merge(lambda width: from_float(f[rs1], width))
+        if f3 == 1 and funct6 == 0x10 and rs1 == 0:     # vfmv.f.s
+            def move_to_f(pc):
+                sew, _ = state(pc, True)
+                f[vd] = to_float(get(vs2, 0, sew), sew)
+                return pc + size
+            return move_to_f, "vfpu"
+        if f3 == 5 and funct6 == 0x10 and vs2 == 0:     # vfmv.s.f
+            def move_from_f(pc):
+                sew, vl = state(pc, True)
+                if vl:
+                    put(vd, 0, sew, from_float(f[rs1], sew))
+                return pc + size
+            return move_from_f, "vfpu"
+        if f3 == 1 and funct6 == 0x12:                  # conversions
+            def rounding(mode):
+                return mode if mode is not None else machine.csr.get(0x002, 0)
+
+            def to_int(is_signed, mode=None):
+                def compute(a, b, d, w):
+                    low, high = (-(1 << (w - 1)), (1 << (w - 1)) - 1) if is_signed else (0, (1 << w) - 1)
+                    return float_to_int(to_float(a, w), low, high, rounding(mode))
+                return compute
+            conversions = {
+                0x00: (to_int(False), 1, 1),                                            # vfcvt.xu.f.v
+                0x01: (to_int(True), 1, 1),                                             # vfcvt.x.f.v
+                0x02: (lambda a, b, d, w: from_float(float(a), w), 1, 1),              # vfcvt.f.xu.v
+                0x03: (lambda a, b, d, w: from_float(float(sext(a, w)), w), 1, 1),     # vfcvt.f.x.v
+                0x06: (to_int(False, 1), 1, 1),                                         # vfcvt.rtz.xu.f.v
+                0x07: (to_int(True, 1), 1, 1),                                          # vfcvt.rtz.x.f.v
+                0x0C: (lambda a, b, d, w: from_float(to_float(a, w), 2 * w), 2, 1),    # vfwcvt.f.f.v
+                0x14: (lambda a, b, d, w: from_float(to_float(a, 2 * w), w), 1, 2),    # vfncvt.f.f.w
+            }
+            if rs1 not in conversions:
+                return None
+            compute, dest, src2 = conversions[rs1]
+            return elementwise(compute, "vfpu", dest=dest, src2=src2, fp_bits=True, unary=True)
+        if f3 == 1 and funct6 == 0x13 and rs1 == 0:     # vfsqrt
+            return elementwise(lambda a, b, d, w: math.sqrt(a) if a >= 0 else math.nan, "vfdiv",
+                               fp=True, unary=True)
+        return None
+
+    def decode_vector_memory(self, inst, size, get, put, state, group, check, beats, illegal):
+        """Vector loads and stores: unit-stride, strided, indexed, segment, whole-register, mask."""
+        x = self.x
+        machine = self
+        mask = self.mask
+        vlenb = self.vlenb
+        vlen = self.vlen
+
+        is_load = inst & 0x7F == 0x07
+        vd = (inst >> 7) & 0x1F
+        eew = {0: 8, 5: 16, 6: 32, 7: 64}[(inst >> 12) & 7]
+        rs1 = (inst >> 15) & 0x1F
+        rs2 = (inst >> 20) & 0x1F                       # stride register, index group or umop
+        vm = (inst >> 25) & 1
+        mop = (inst >> 26) & 3
+        fields = (inst >> 29) + 1
+        if inst >> 28 & 1 or eew > self.elen:
+            return None
+        loads = {8: self.load8u, 16: self.load16u, 32: self.load32u, 64: self.load64}
+        stores = {8: self.store8, 16: self.store16, 32: self.store32, 64: self.store64}
+        kind = "vload" if is_load else "vstore"
+
+        if mop == 0 and rs2 == 0x08:                    # vl<nf>r / vs<nf>r (whole registers)
+            if fields not in (1, 2, 4, 8) or vd & (fields - 1):
+                return None
+            load, store = loads[eew], stores[eew]
+            n = eew >> 3
+            count = fields * vlenb // n
+
+            def whole(pc):
+                base = x[rs1]
+                for i in range(count):
+                    if is_load:
+                        put(vd, i, eew, load((base + i * n) & mask))
+                    else:
+                        store((base + i * n) & mask, get(vd, i, eew))
+                beats(fields * vlen)
+                return pc + size
+            return whole, kind
+
+        if mop == 0 and rs2 == 0x0B:                    # vlm.v / vsm.v
+            if eew != 8 or fields != 1 or not vm:
+                return None
+
+            def mask_access(pc):
+                _, vl = state(pc)
+                base = x[rs1]
+                for i in range((vl + 7) >> 3):
+                    if is_load:
+                        put(vd, i, 8, machine.load8u((base + i) & mask))
+                    else:
+                        machine.store8((base + i) & mask, get(vd, i, 8))
+                beats(vl)
+                return pc + size
+            return mask_access, kind
+
+        first_only = mop == 0 and rs2 == 0x10           # vle<eew>ff
+        if mop == 0 and rs2 and not (first_only and is_load):
+            return None
+        indexed = mop & 1
+        strided = mop == 2
+
+        def access(pc):
+            sew, vl = state(pc)
+            width = sew if indexed else eew             # indexed: eew is the index width
+            check(pc, sew, (vd, width), *(((rs2, eew),) if indexed else ()))
+            regs = group(sew, width)
+            if vd + fields * regs > 32:
+                raise illegal(pc, "segment past v31")
+            n = width >> 3
+            load, store = loads[width], stores[width]
+            base = x[rs1]
+            stride = machine.signed(x[rs2]) if strided else fields * n
+            for i in range(vl):
+                if not vm and not get(0, i >> 3, 8) >> (i & 7) & 1:
+                    continue
+                addr = base + (get(rs2, i, eew) if indexed else i * stride)
+                if is_load:
+                    try:
+                        values = [load((addr + k * n) & mask) for k in range(fields)]
+                    except Halt:
+                        # Fault-only-first: a fault past element 0 just shortens vl
+                        if not (first_only and i):
+                            raise
+                        machine.vl = i
+                        break
+                    for k, value in enumerate(values):
+                        put(vd + k * regs, i, width, value)
+                else:
+                    for k in range(fields):
+                        store((addr + k * n) & mask, get(vd + k * regs, i, width))
+            if indexed or strided:
+                machine.cycles += max(machine.vl * fields - 1, 0)
+            else:
+                beats(machine.vl * fields * width)
+            return pc + size
+        return access, kind
+
+    # -- running ------------------------------------------------------------
+
+    def run(self, entry: int, limit: int, functions: dict = None, profile: dict = None) -> dict:
+        """
+        Run from entry for at most 'limit' instructions.
+
+        functions maps addresses to names to time: a call is counted from
+        the function's first instruction until it returns to the caller's
+        return address (recursive calls are counted once). With a profile
+        dict, the cycles of every instruction are added up per address.
+        Returns {"reason", "code", "message", "pc", "instructions", "cycles",
+        "fetched", "functions": {name: {"calls", "cycles", "instructions"}}};
+        "fetched" is the instruction bytes executed (the fetch traffic of a
+        core without an instruction cache).
+        """
+        cache = self.cache
+        decode = self.decode
+        penalty = self.costs["taken"]
+        x = self.x
+        watch = functions or {}
+        timed = {name: {"calls": 0, "cycles": 0, "instructions": 0} for name in watch.values()}
+        active = []                                     # (return address, name, cycles, instructions)
+
+        pc = entry
+        cycles = self.cycles
+        n = self.instret
+        stop = n + limit
+        fetched = 0
+        reason, code, message = "limit", None, f"instruction limit ({limit}) reached"
+        try:
+            while n < stop:
+                decoded = cache.get(pc)
+                if decoded is None:
+                    decoded = cache[pc] = decode(pc)
+                fn, size, cost, sync = decoded
+                if watch:
+                    if active and pc == active[-1][0]:
+                        ret, name, c0, n0 = active.pop()
+                        if not any(call[1] == name for call in active):
+                            timed[name]["cycles"] += cycles - c0
+                            timed[name]["instructions"] += n - n0
+                    if pc in watch:
+                        name = watch[pc]
+                        timed[name]["calls"] += 1
+                        active.append((x[1], name, cycles, n))
+                if sync:
+                    self.cycles = cycles
+                    self.instret = n
+                    npc = fn(pc)
+                    cycles = self.cycles
+                    n = self.instret
+                else:
+                    npc = fn(pc)
+                n += 1
+                fetched += size
+                if npc != pc + size:
+                    if npc == pc:
+                        cycles += cost
+                        reason, code, message = "halt", self.signed(x[10]), f"stopped at 0x{pc:x} (jump to self)"
+                        break
+                    cost += penalty
+                cycles += cost
+                if profile is not None:
+                    profile[pc] = profile.get(pc, 0) + cost
+                pc = npc
+        except Halt as e:
+            reason, code, message = e.reason, e.code, str(e)
+        except RecursionError:
+            reason, message = "fault", f"fault at 0x{pc:x}"
+
+        # Calls still running when the program stopped count up to here
+        counted = set()
+        for ret, name, c0, n0 in active:
+            if name not in counted:
+                counted.add(name)
+                timed[name]["cycles"] += cycles - c0
+                timed[name]["instructions"] += n - n0
+
+        self.cycles = cycles
+        self.instret = n
+        self.pc = pc
+        self.flush_output()
+        return {
+            "reason": reason,
+            "code": code,
+            "message": message,
+            "pc": pc,
+            "instructions": n,
+            "cycles": cycles,
+            "fetched": fetched,
+            "functions": timed,
+        }
+
+
+def float_divide(a: float, b: float) -> float:
+    """a / b with IEEE results for division by zero."""
+    if b == 0:
+        return math.nan if a == 0 or math.isnan(a) else math.copysign(math.inf, a) * math.copysign(1, b)
+    return a / b
+
+
+def float_min_max(a: float, b: float, want_max: bool) -> float:
+    """fmin/fmax: a NaN operand loses, -0.0 is less than 0.0."""
+    if math.isnan(a):
+        return b
+    if math.isnan(b):
+        return a
+    if a == b == 0:
+        negative = math.copysign(1, a) < 0 or math.copysign(1, b) < 0
+        positive = math.copysign(1, a) > 0 or math.copysign(1, b) > 0
+        if want_max:
+            return 0.0 if positive else -0.0
+        return -0.0 if negative else 0.0
+    return max(a, b) if want_max else min(a, b)
+
+
+def float_to_int(value: float, low: int, high: int, mode: int) -> int:
+    """fcvt to an integer in [low, high]: out-of-range values and NaN saturate."""
+    if math.isnan(value):
+        return high
+    if math.isinf(value):
+        return high if value > 0 else low
+    return min(max(round_float(value, mode), low), high)
+
+
+def round_float(value: float, mode: int) -> int:
+    """Round to an integer with a RISC-V rounding mode (RNE, RTZ, RDN, RUP, RMM)."""
+    if mode == 1:
+        return math.trunc(value)
+    if mode == 2:
+        return math.floor(value)
+    if mode == 3:
+        return math.ceil(value)
+    if mode == 4:
+        return int(math.copysign(math.floor(abs(value) + 0.5), value))
+    return round(value)
@@ -0,0 +1,56 @@
+#!/bin/sh
+#
+# Prune the toolchain stage of the Docker build down to what 'rv' needs.
+#
+# Runs inside the build stage after the packages and rv are installed; the
+# runtime stage then copies the pruned filesystem in one layer. It removes:
+#   1. newlib/libgcc multilibs that none of rv's architectures select
+#   2. binutils and gcc helpers rv never runs
+#   3. Python stdlib packages rv never imports, docs and package caches
+#
+# Multilibs are kept by asking gcc which directory it would link for every
+# architecture 'rv prebuild --list' reports (ARCH_PRESETS plus the common
+# Zba/Zbb combinations), both as given and with the _zicsr that bare builds
+# add. The default multilib (".") is always kept, as gcc falls back to it
+# for any other -march.
+#
+
+set -eu
+
+TRIPLE=riscv-none-elf
+GCC=$TRIPLE-gcc
+
+# 1. Multilibs
+keep=$(rv prebuild --list | while read -r march mabi; do
+    $GCC -march="$march" -mabi="$mabi" -print-multi-directory
+    $GCC -march="${march}_zicsr" -mabi="$mabi" -print-multi-directory
+done | sort -u)
+
+libgcc_dir=$(dirname "$($GCC -print-libgcc-file-name)")
+newlib_dir=$(dirname "$($GCC -print-file-name=libc.a)")
+
+echo "Keeping multilibs:" $keep
+for dir in $($GCC -print-multi-lib | cut -d';' -f1); do
+    [ "$dir" = "." ] && continue
+    echo "$keep" | grep -qx "$dir" && continue
+    # Don't remove a parent of a kept multilib
+    echo "$keep" | grep -q "^$dir/" && continue
+    rm -rf "${libgcc_dir:?}/$dir" "${newlib_dir:?}/$dir"
+    # and its parent (rv32e for rv32e/ilp32e) once empty
+    rmdir "$libgcc_dir/${dir%/*}" "$newlib_dir/${dir%/*}" 2>/dev/null || true
+done
+
+# 2. Tools: rv runs gcc (cc1, as, ld, lto1 for -flto), objdump and objcopy,
+# and reads sizes and symbols itself
+for tool in addr2line c++filt cpp elfedit gcc-ar gcc-nm gcc-ranlib gcov gcov-dump \
+            gcov-tool gprof lto-dump nm readelf size strings strip; do
+    rm -f "/usr/bin/$TRIPLE-$tool"
+done
+rm -f "/usr/$TRIPLE/bin/nm" "/usr/$TRIPLE/bin/readelf" "/usr/$TRIPLE/bin/strip"
+
+# 3. Python stdlib parts rv doesn't use, docs and caches
+stdlib=$(python3 -c 'import sysconfig; print(sysconfig.get_paths()["stdlib"])')
+for pkg in test idlelib tkinter turtledemo ensurepip lib2to3 pydoc_data unittest/test; do
+    rm -rf "${stdlib:?}/$pkg"
+done
+rm -rf /usr/share/man /usr/share/info /usr/share/doc /var/cache/apk/* /root/.cache
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""
+Tests for 'rv build --workers' failure handling.
+
+Run: python3 scripts/test_rv_workers.py
+
+Sources are compiled with the host gcc (TOOL_PREFIX is cleared), so no
+RISC-V toolchain is needed.
+"""
+
+import importlib.machinery
+import importlib.util
+import socket
+import sys
+import tempfile
+import threading
+import time
+import unittest
+from pathlib import Path
+
+SCRIPTS = Path(__file__).resolve().parent
+sys.path.insert(0, str(SCRIPTS))
+loader = importlib.machinery.SourceFileLoader("rv", str(SCRIPTS / "rv"))
+rv = importlib.util.module_from_spec(importlib.util.spec_from_loader("rv", loader))
+loader.exec_module(rv)
+
+
+class SilentWorker:
+    """A worker that answers status requests but never answers a compile."""
+
+    def __init__(self, path: Path):
+        self.path = str(path)
+        self.compiles = 0
+        self.server = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.server.bind(self.path)
+        self.server.listen()
+        self.held = []
+        threading.Thread(target=self.serve, daemon=True).start()
+
+    def serve(self):
+        while True:
+            try:
+                conn, _ = self.server.accept()
+            except OSError:
+                return
+            header, _ = rv.recv_message(conn)
+            if header.get("op") == "status":
+                rv.send_message(conn, {"jobs": 1})
+                conn.close()
+            else:
+                # Keep the connection open and say nothing
+                self.compiles += 1
+                self.held.append(conn)
+
+    def close(self):
+        self.server.close()
+        for conn in self.held:
+            conn.close()
+
+
+class WorkerTimeoutTest(unittest.TestCase):
+    def setUp(self):
+        self.tmp = Path(tempfile.mkdtemp())
+        self.prefix = rv.TOOL_PREFIX
+        rv.TOOL_PREFIX = ""
+        self.worker = SilentWorker(self.tmp / "worker.sock")
+
+    def tearDown(self):
+        rv.TOOL_PREFIX = self.prefix
+        self.worker.close()
+
+    def test_silent_worker_falls_back_to_local(self):
+        sources = []
+        for name in ("a", "b", "c"):
+            source = self.tmp / f"{name}.c"
+            source.write_text(f"int {name}(int x) {{ return x + 1; }}\n")
+            sources.append(source)
+
+        start = time.monotonic()
+        result = rv.compile_objects(sources, ["-O2"], None, self.tmp / "cache", 1,
+                                    workers=[self.worker.path], worker_timeout=0.5)
+        elapsed = time.monotonic() - start
+
+        self.assertEqual(self.worker.compiles, 1)
+        self.assertLess(elapsed, 30)
+        self.assertEqual(len(result["objects"]), len(sources))
+        for obj in result["objects"]:
+            self.assertTrue(Path(obj).is_file(), obj)
+        self.assertEqual(result["placement"].get(rv.WorkerPool.LOCAL), len(sources))
+
+
+if __name__ == "__main__":
+    unittest.main()